@@ -0,0 +1,128 @@
+// Alocador buddy para subdividir um buffer grande em faixas
+//
+// Trabalha em unidades abstratas (vértices, índices...), não em bytes, para que todo
+// deslocamento devolvido seja um índice válido no buffer. A capacidade é uma potência
+// de 2 vezes o bloco mínimo; cada pedido é arredondado para o bloco potência de 2 que
+// o contém, e ao liberar um bloco ele é fundido com o "irmão" (buddy) se este também
+// estiver livre. As listas livres são ordenadas, então as alocações ocupam primeiro
+// os endereços mais baixos.
+
+#pragma once
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+class BuddyAllocator
+{
+public:
+	static const size_t INVALID = SIZE_MAX;
+
+	// capacity é arredondada para cima (minBlock * 2^n)
+	void reset(size_t capacity, size_t minBlock = 64)
+	{
+		this->minBlock = minBlock;
+		top = 0;
+		while ((minBlock << top) < capacity)
+			top++;
+		freeLists.assign(top + 1, std::set<size_t>());
+		freeLists[top].insert(0);
+		allocated.clear();
+		usedUnits = 0;
+	}
+
+	// Retorna o deslocamento da faixa ou INVALID se não houver bloco livre grande o bastante
+	size_t allocate(size_t count)
+	{
+		int order = orderFor(count);
+		if (order > top)
+			return INVALID;
+		int o = order;
+		while (o <= top && freeLists[o].empty())
+			o++;
+		if (o > top)
+			return INVALID;
+
+		size_t offset = *freeLists[o].begin();
+		freeLists[o].erase(freeLists[o].begin());
+		// Divide até o tamanho pedido; as metades de cima ficam livres
+		while (o > order)
+		{
+			o--;
+			freeLists[o].insert(offset + blockSize(o));
+		}
+		allocated[offset] = order;
+		usedUnits += blockSize(order);
+		return offset;
+	}
+
+	void release(size_t offset)
+	{
+		auto it = allocated.find(offset);
+		if (it == allocated.end())
+			return;
+		int order = it->second;
+		allocated.erase(it);
+		usedUnits -= blockSize(order);
+		insertFree(offset, order);
+	}
+
+	// Dobra a capacidade: a nova metade entra como um bloco livre
+	void grow()
+	{
+		size_t oldCapacity = capacity();
+		top++;
+		freeLists.resize(top + 1);
+		insertFree(oldCapacity, top - 1);
+	}
+
+	// Tamanho reservado para um pedido (arredondado para o bloco)
+	size_t blockFor(size_t count) const { return blockSize(orderFor(count)); }
+
+	size_t capacity() const { return blockSize(top); }
+	size_t used() const { return usedUnits; }
+	size_t allocations() const { return allocated.size(); }
+
+	size_t largestFree() const
+	{
+		for (int o = top; o >= 0; o--)
+			if (!freeLists[o].empty())
+				return blockSize(o);
+		return 0;
+	}
+
+private:
+	size_t minBlock = 64;
+	int top = 0; // ordem do bloco que cobre tudo
+	std::vector<std::set<size_t>> freeLists;
+	std::unordered_map<size_t, int> allocated; // deslocamento -> ordem
+	size_t usedUnits = 0;
+
+	size_t blockSize(int order) const { return minBlock << order; }
+
+	int orderFor(size_t count) const
+	{
+		int order = 0;
+		while (blockSize(order) < count)
+			order++;
+		return order;
+	}
+
+	// Insere um bloco livre, fundindo com o buddy enquanto possível
+	void insertFree(size_t offset, int order)
+	{
+		while (order < top)
+		{
+			size_t buddy = offset ^ blockSize(order);
+			auto it = freeLists[order].find(buddy);
+			if (it == freeLists[order].end())
+				break;
+			freeLists[order].erase(it);
+			offset = offset < buddy ? offset : buddy;
+			order++;
+		}
+		freeLists[order].insert(offset);
+	}
+};
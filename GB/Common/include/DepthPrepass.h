@@ -0,0 +1,179 @@
+// Pré-passada de profundidade
+//
+// Só com o teste de profundidade, um fragmento desenhado antes de algo que fica na frente
+// dele roda o phong à toa. Na pré-passada a cena é desenhada primeiro só no buffer de
+// profundidade (cor desligada, fragment shader vazio), da frente para trás. Depois, na
+// passada de cor (GL_LEQUAL, sem escrever profundidade), só o fragmento mais próximo de
+// cada pixel passa no teste: o early-Z descarta o resto antes do fragment shader, e o
+// phong roda uma vez por pixel.
+//
+// A pré-passada lê um fluxo só de posições (PositionVertex: 12 bytes por vértice contra
+// os 44 do ObjVertex): as malhas são copiadas para um GeometryPool próprio, com os mesmos
+// índices. Lotes instanciados leem as cópias de onde o InstanceBatch as deixou no quadro
+// (buffer próprio ou FrameRing, instanced()), sem cópia. Para as duas passadas chegarem à mesma profundidade, depth.vs
+// faz a mesma conta do phong.vs e os dois declaram gl_Position invariant.
+//
+//   prepass.begin(); ...desenhos de profundidade...; prepass.end();
+//   ...passada de cor...; DepthPrepass::restore();
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLExtensoes.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+#include "VertexLayout.h"
+#include "GeometryPool.h"
+#include "InstanceBatch.h"
+
+class DepthPrepass
+{
+public:
+	using Pool = GeometryPool<PositionVertex>;
+	using Handle = Pool::Handle;
+
+	void create(GpuMemoryRegistry *registry = nullptr)
+	{
+		this->registry = registry;
+		pool.create(1 << 16, 1 << 10, registry, "depth pool");
+	}
+
+	// Copia a posição (os 3 primeiros floats) de cada vértice com floatsPerVertex floats
+	Handle add(const GLfloat *vertices, size_t vertexCount, size_t floatsPerVertex, const GLuint *indices = nullptr,
+			   size_t indexCount = 0)
+	{
+		std::vector<GLfloat> positions(vertexCount * 3);
+		for (size_t v = 0; v < vertexCount; v++)
+			std::copy(vertices + v * floatsPerVertex, vertices + v * floatsPerVertex + 3, positions.begin() + v * 3);
+		return pool.add(positions.data(), vertexCount, indices, indexCount);
+	}
+
+	// VAO com as posições do pool e as instâncias (formato InstanceStream) do batch
+	template <typename Layout>
+	GLuint instanced(const InstanceBatch<Layout> &batch)
+	{
+		InstancedArray array;
+		glGenVertexArrays(1, &array.vao);
+		pool.attach(array.vao);
+		useInstanceSource(array, batch.source(), batch.sourceGeneration());
+		instancedArrays.push_back(array);
+		return array.vao;
+	}
+
+	// Só profundidade: cor desligada, GL_LESS
+	void begin() const
+	{
+		glState.colorMask(GL_FALSE);
+		glState.depthMask(GL_TRUE);
+		glState.depthFunc(GL_LESS);
+	}
+
+	// Passada de cor sobre a profundidade pronta: passa só quem ficou na frente
+	void end() const
+	{
+		glState.colorMask(GL_TRUE);
+		glState.depthMask(GL_FALSE);
+		glState.depthFunc(GL_LEQUAL);
+	}
+
+	// Estado normal, antes do glClear do próximo quadro (que respeita a máscara de profundidade)
+	static void restore()
+	{
+		glState.depthMask(GL_TRUE);
+		glState.depthFunc(GL_LESS);
+	}
+
+	// O programa ativo precisa ser o depth.vs, com a matriz "model" já definida
+	void draw(Handle mesh, GLenum mode = GL_TRIANGLES) const
+	{
+		MeshRange range = pool.range(mesh);
+		glState.bindVertexArray(pool.vao());
+		if (range.indexCount)
+			glDrawElementsBaseVertex(mode, range.indexCount, GL_UNSIGNED_INT, (GLvoid *)(range.firstIndex * sizeof(GLuint)),
+									 range.firstVertex);
+		else
+			glDrawArrays(mode, range.firstVertex, range.vertexCount);
+	}
+
+	// As cópias do batch (depois do upload() do quadro) lidas pelo VAO de instanced(),
+	// que é reapontado se o batch passou para outro buffer ou o anel foi recriado
+	// (programa: depth.vs com INSTANCING)
+	template <typename Layout>
+	void drawInstanced(GLuint vao, const InstanceBatch<Layout> &batch, Handle mesh, GLenum mode = GL_TRIANGLES)
+	{
+		GLsizei count = (GLsizei)batch.size();
+		if (count <= 0)
+			return;
+		for (InstancedArray &array : instancedArrays)
+			if (array.vao == vao)
+				useInstanceSource(array, batch.source(), batch.sourceGeneration());
+		GLuint first = batch.firstInstance();
+		MeshRange range = pool.range(mesh);
+		glState.bindVertexArray(vao);
+		if (first && range.indexCount)
+			glx::DrawElementsInstancedBaseVertexBaseInstance(mode, range.indexCount, GL_UNSIGNED_INT,
+															 (GLvoid *)(range.firstIndex * sizeof(GLuint)), count,
+															 range.firstVertex, first);
+		else if (first)
+			glx::DrawArraysInstancedBaseInstance(mode, range.firstVertex, range.vertexCount, count, first);
+		else if (range.indexCount)
+			glDrawElementsInstancedBaseVertex(mode, range.indexCount, GL_UNSIGNED_INT,
+											  (GLvoid *)(range.firstIndex * sizeof(GLuint)), count, range.firstVertex);
+		else
+			glDrawArraysInstanced(mode, range.firstVertex, range.vertexCount, count);
+	}
+
+	GLuint vao() const { return pool.vao(); }
+	const Pool &geometry() const { return pool; }
+
+	// Reempacota o pool de posições (os VAOs de instanced() são reapontados pelo pool)
+	int defragment() { return pool.defragment(); }
+
+	// Os buffers de instâncias são dos InstanceBatch: aqui só saem os VAOs
+	void destroy()
+	{
+		for (InstancedArray &array : instancedArrays)
+		{
+			pool.detach(array.vao);
+			glState.forgetVertexArray(array.vao);
+			glDeleteVertexArrays(1, &array.vao);
+		}
+		instancedArrays.clear();
+		if (registry)
+			registry->releaseVertexArray(pool.vao());
+		else
+			pool.destroy();
+	}
+
+private:
+	// VAO de instanced() e o buffer de instâncias para onde ele aponta
+	struct InstancedArray
+	{
+		GLuint vao = 0;
+		GLuint source = 0;
+		unsigned generation = 0;
+	};
+
+	Pool pool;
+	std::vector<InstancedArray> instancedArrays;
+	GpuMemoryRegistry *registry = nullptr;
+
+	static void useInstanceSource(InstancedArray &array, GLuint buffer, unsigned generation)
+	{
+		if (array.source == buffer && array.generation == generation)
+			return;
+		array.source = buffer;
+		array.generation = generation;
+		glState.bindVertexArray(array.vao);
+		glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+		InstanceStream::setup(0, 1);
+		glState.bindVertexArray(0);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
@@ -0,0 +1,155 @@
+// Quadro em pipeline: simulação numa thread própria, render (OpenGL) na principal
+//
+// A simulação produz instantâneos (snapshots) do estado já prontos para desenhar:
+// posições, matrizes, câmera. São dois: enquanto o render lê o instantâneo do quadro N,
+// a simulação escreve o do quadro N+1 no outro. Um instantâneo publicado não muda mais,
+// então o render o lê sem trava. A simulação do quadro N+1 usa a entrada (teclado,
+// câmera) colhida no início do quadro N: o pipeline custa um quadro de latência.
+//
+// Sem thread (setThreaded(false)), beginFrame() simula na hora, como um laço comum.
+//
+// Uso, na thread principal:
+//   const Snapshot &s = pipeline.beginFrame(input); ... desenha s ... pipeline.endFrame();
+
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+template <typename Input, typename Snapshot>
+class FramePipeline
+{
+public:
+	// Avança "state" um quadro com a entrada dada. No modo com thread roda na thread de
+	// simulação: só pode ler o que não muda durante o laço (ou o que vem em Input).
+	using Simulate = std::function<void(const Input &, Snapshot &)>;
+
+	~FramePipeline()
+	{
+		stop();
+	}
+
+	void create(Simulate simulate, const Snapshot &initial, bool threaded)
+	{
+		this->simulate = simulate;
+		state = initial;
+		setThreaded(threaded);
+	}
+
+	// Troca de modo entre quadros (fora de beginFrame/endFrame)
+	void setThreaded(bool threaded)
+	{
+		stop();
+		slots[0] = state;
+		requested = consumed = 0;
+		produced = 1; // o instantâneo 0 é o estado atual
+		if (threaded)
+		{
+			stopping = false;
+			worker = std::thread(&FramePipeline::simulationLoop, this);
+		}
+	}
+
+	bool isThreaded() const { return worker.joinable(); }
+
+	// Entrega a entrada deste quadro à simulação e devolve o instantâneo a desenhar
+	const Snapshot &beginFrame(const Input &input)
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (!isThreaded())
+		{
+			simulate(input, state);
+			slots[0] = state;
+			current = &slots[0];
+			lastSimulate = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+			lastWait = 0.0;
+			return *current;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		frame = requested;
+		inputs[frame % 2] = input;
+		requested = frame + 1;
+		cond.notify_all();
+		// Normalmente já está pronto: a simulação fez esse quadro enquanto o anterior era desenhado
+		cond.wait(lock, [&] { return produced >= frame + 1; });
+		current = &slots[frame % 2];
+		lastWait = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+		return *current;
+	}
+
+	// Libera o instantâneo do quadro para a simulação reescrever
+	void endFrame()
+	{
+		if (!isThreaded())
+			return;
+		std::lock_guard<std::mutex> lock(mutex);
+		consumed = frame + 1;
+		cond.notify_all();
+	}
+
+	void stop()
+	{
+		if (!worker.joinable())
+			return;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		cond.notify_all();
+		worker.join();
+	}
+
+	// Quanto o render esperou pela simulação no último quadro (microssegundos)
+	double lastWaitMicroseconds() const { return lastWait; }
+	// Duração da última simulação (microssegundos)
+	double lastSimulateMicroseconds() const { return lastSimulate; }
+
+private:
+	Simulate simulate;
+	Snapshot state;	   // estado da simulação (só a thread que simula mexe)
+	Snapshot slots[2]; // instantâneo k fica em slots[k % 2]
+	Input inputs[2];   // entrada do quadro k em inputs[k % 2]
+	const Snapshot *current = nullptr;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool stopping = false;
+	uint64_t requested = 0; // entradas entregues pelo render
+	uint64_t produced = 1;	// instantâneos publicados
+	uint64_t consumed = 0;	// instantâneos que o render já liberou
+	uint64_t frame = 0;		// quadro que o render está desenhando
+	double lastWait = 0.0;
+	std::atomic<double> lastSimulate{0.0}; // escrito pela thread de simulação
+
+	void simulationLoop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			// O instantâneo p precisa da entrada p - 1 e de slots[p % 2] livre (p - 2 liberado)
+			cond.wait(lock, [&] { return stopping || (requested >= produced && consumed + 1 >= produced); });
+			if (stopping)
+				break;
+			uint64_t p = produced;
+			Input input = inputs[(p - 1) % 2];
+			lock.unlock();
+
+			auto start = std::chrono::steady_clock::now();
+			simulate(input, state);
+			slots[p % 2] = state;
+			double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+			lock.lock();
+			lastSimulate = elapsed;
+			produced = p + 1;
+			cond.notify_all();
+		}
+	}
+};
@@ -0,0 +1,225 @@
+// Anel de dados por quadro num buffer persistentemente mapeado, dividido em 3 regiões
+//
+// Dados que mudam todo quadro (matrizes e materiais por desenho, comandos indiretos)
+// são escritos com memcpy direto na memória mapeada, sem glMap/glUnmap e sem
+// glBufferData/glBufferSubData. Cada quadro usa uma das 3 regiões; no fim do quadro um
+// fence marca a região, e ela só é reescrita 3 quadros depois, quando beginFrame()
+// confirma que a GPU terminou de ler. Enquanto a GPU está até 2 quadros atrás, a CPU
+// nunca espera.
+//
+// Os deslocamentos devolvidos são absolutos no buffer e podem ter qualquer alinhamento
+// (não só potências de 2): com alinhamento igual ao stride de um formato por instância,
+// offset / stride serve direto como baseInstance.
+//
+// Se o quadro pede mais do que cabe na região, a reserva falha (quem chama usa outro
+// caminho nesse quadro) e o anel cresce no próximo beginFrame(). Sem glBufferStorage,
+// os dados vão para uma cópia na CPU e flush() os envia com glBufferSubData.
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLExtensoes.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+
+// Faixa reservada no quadro atual
+struct FrameAllocation
+{
+	unsigned char *ptr = nullptr; // onde escrever
+	size_t offset = 0;			  // deslocamento no buffer (para os ponteiros GL)
+	size_t size = 0;
+
+	bool valid() const { return ptr != nullptr; }
+};
+
+class FrameRing
+{
+public:
+	static const int FRAMES = 3;
+
+	void create(size_t regionSize, GpuMemoryRegistry *registry = nullptr, const std::string &name = "frame ring")
+	{
+		this->registry = registry;
+		this->name = name;
+		allocateStorage(regionSize);
+	}
+
+	void destroy()
+	{
+		for (GLsync &fence : fences)
+			if (fence)
+			{
+				glDeleteSync(fence);
+				fence = 0;
+			}
+		releaseStorage();
+	}
+
+	// Começa o quadro na próxima região, esperando a GPU liberar essa região se preciso
+	void beginFrame()
+	{
+		if (demand > regionSize)
+		{
+			// O quadro anterior não coube: espera tudo e recria maior
+			size_t newSize = regionSize;
+			while (newSize < demand)
+				newSize *= 2;
+			for (GLsync &fence : fences)
+				waitAndDelete(fence);
+			releaseStorage();
+			allocateStorage(newSize);
+			generationCount++;
+		}
+		demand = 0;
+
+		frameCount++;
+		region = (region + 1) % FRAMES;
+		if (fences[region])
+		{
+			if (glClientWaitSync(fences[region], 0, 0) == GL_TIMEOUT_EXPIRED)
+				stalls++;
+			waitAndDelete(fences[region]);
+		}
+		head = 0;
+		flushed = 0;
+	}
+
+	// Marca o fim dos comandos que leem a região do quadro
+	void endFrame()
+	{
+		flush();
+		if (fences[region])
+			glDeleteSync(fences[region]);
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Reserva size bytes no quadro atual; alignment pode ser qualquer valor >= 1
+	FrameAllocation allocate(size_t size, size_t alignment = 4)
+	{
+		FrameAllocation a;
+		size_t base = region * regionSize;
+		size_t offset = (base + head + alignment - 1) / alignment * alignment;
+		size_t end = offset + size - base;
+		demand = std::max(demand, end + alignment);
+		if (end > regionSize)
+			return a;
+		head = end;
+		a.ptr = mapped + offset;
+		a.offset = offset;
+		a.size = size;
+		return a;
+	}
+
+	// Sem mapeamento persistente: envia o que foi escrito desde o último flush
+	void flush()
+	{
+		if (persistent || head <= flushed)
+			return;
+		size_t base = region * regionSize;
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, id);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, base + flushed, head - flushed, mapped + base + flushed);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		flushed = head;
+	}
+
+	GLuint buffer() const { return id; }
+	bool isPersistent() const { return persistent; }
+	size_t size() const { return regionSize; }
+	// Muda quando o buffer é recriado (quem guardou buffer() em VAOs deve refazer)
+	unsigned generation() const { return generationCount; }
+	// Conta os beginFrame(): reservas de um número anterior já não valem
+	unsigned long frame() const { return frameCount; }
+	// Quadros em que a CPU teve de esperar a GPU liberar a região
+	unsigned long stallCount() const { return stalls; }
+
+private:
+	GLuint id = 0;
+	unsigned char *mapped = nullptr;
+	std::vector<unsigned char> shadow;
+	bool persistent = false;
+	size_t regionSize = 0;
+	int region = 0;
+	size_t head = 0, flushed = 0;
+	size_t demand = 0; // maior uso pedido no quadro (inclui reservas que falharam)
+	GLsync fences[FRAMES] = {};
+	unsigned generationCount = 0;
+	unsigned long frameCount = 0;
+	unsigned long stalls = 0;
+	GpuMemoryRegistry *registry = nullptr;
+	std::string name;
+
+	static void waitAndDelete(GLsync &fence)
+	{
+		if (!fence)
+			return;
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+			;
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	void allocateStorage(size_t size)
+	{
+		regionSize = size;
+		size_t total = regionSize * FRAMES;
+		glGenBuffers(1, &id);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, id);
+		if (glx::BufferStorage)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glx::BufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+			mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+		}
+		persistent = mapped != nullptr;
+		if (!persistent)
+		{
+			if (glx::BufferStorage)
+			{
+				// Armazenamento imutável sem mapeamento: recria como buffer comum
+				glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+				glState.forgetBuffer(id);
+				glDeleteBuffers(1, &id);
+				glGenBuffers(1, &id);
+				glState.bindBuffer(GL_COPY_WRITE_BUFFER, id);
+			}
+			glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+			shadow.assign(total, 0);
+			mapped = shadow.data();
+		}
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (registry)
+			registry->trackBuffer(id, GL_ARRAY_BUFFER, total, GpuSubsystem::Upload, name);
+		region = FRAMES - 1;
+		head = flushed = 0;
+	}
+
+	void releaseStorage()
+	{
+		if (!id)
+			return;
+		if (persistent)
+		{
+			glState.bindBuffer(GL_COPY_WRITE_BUFFER, id);
+			glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+			glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		}
+		if (registry)
+			registry->release(GpuResourceType::Buffer, id);
+		else
+		{
+			glState.forgetBuffer(id);
+			glDeleteBuffers(1, &id);
+		}
+		id = 0;
+		mapped = nullptr;
+		shadow.clear();
+		persistent = false;
+	}
+};
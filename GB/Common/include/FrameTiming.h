@@ -0,0 +1,162 @@
+// Relógio da simulação com passo fixo e controle do ritmo dos quadros
+//
+// FixedTimestep: a simulação avança sempre em passos de "step" segundos, quantos
+// couberem no tempo real decorrido. O tempo é acumulado em double, então não perde
+// precisão depois de horas rodando. O que sobra (menos de um passo) vira alpha, a fração
+// entre o penúltimo e o último estado, usada para interpolar o que é desenhado: o
+// movimento é o mesmo a 30, 60 ou 144 quadros por segundo. Se um quadro demora demais,
+// no máximo maxSteps passos são simulados e o resto do atraso é descartado (sem isso,
+// um quadro lento gera mais passos, que deixam o próximo ainda mais lento).
+//
+// FramePacer: como o quadro é entregue
+//   VSync        - glfwSwapInterval(1): a troca espera o retraço do monitor
+//   AdaptiveSync - glfwSwapInterval(-1) (WGL/GLX_EXT_swap_control_tear): espera o retraço,
+//                  mas um quadro atrasado troca na hora em vez de esperar o próximo
+//   Limited      - sem vsync; dorme até perto do prazo do quadro e termina girando
+//                  (o sleep do sistema erra por volta de 1 ms, o giro acerta o prazo)
+//   Unlimited    - sem espera nenhuma (para medições)
+
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+// GLFW
+#include <GLFW/glfw3.h>
+
+class FixedTimestep
+{
+public:
+	explicit FixedTimestep(double step = 1.0 / 60.0, int maxSteps = 8) : stepSeconds(step), maxSteps(maxSteps) {}
+
+	// Acumula o tempo até "now" (segundos) e retorna quantos passos simular
+	int advance(double now)
+	{
+		if (!started)
+		{
+			started = true;
+			lastTime = now;
+			return 0;
+		}
+		accumulator += std::max(now - lastTime, 0.0);
+		lastTime = now;
+		int steps = 0;
+		while (accumulator >= stepSeconds && steps < maxSteps)
+		{
+			accumulator -= stepSeconds;
+			simulated += stepSeconds;
+			steps++;
+		}
+		// Atraso além de maxSteps: descartado
+		if (accumulator >= stepSeconds)
+			accumulator = std::fmod(accumulator, stepSeconds);
+		return steps;
+	}
+
+	// Fração [0, 1) do próximo passo já decorrida: peso do estado mais novo na interpolação
+	double alpha() const { return accumulator / stepSeconds; }
+	double step() const { return stepSeconds; }
+	// Tempo simulado total (segundos)
+	double time() const { return simulated; }
+
+private:
+	double stepSeconds;
+	int maxSteps;
+	bool started = false;
+	double lastTime = 0.0;
+	double accumulator = 0.0;
+	double simulated = 0.0;
+};
+
+class FramePacer
+{
+public:
+	enum Mode
+	{
+		VSync,
+		AdaptiveSync,
+		Limited,
+		Unlimited
+	};
+
+	// Precisa do contexto OpenGL atual (glfwSwapInterval age sobre ele)
+	void setMode(Mode mode, double targetFPS = 60.0)
+	{
+		current = mode;
+		period = std::chrono::duration<double>(1.0 / std::max(targetFPS, 1.0));
+		if (mode == AdaptiveSync && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+			!glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			std::cout << "Adaptive sync not supported, using vsync" << std::endl;
+			current = VSync;
+		}
+		glfwSwapInterval(current == VSync ? 1 : current == AdaptiveSync ? -1 : 0);
+		deadline = Clock::time_point();
+	}
+
+	Mode mode() const { return current; }
+
+	const char *modeName() const
+	{
+		switch (current)
+		{
+		case VSync:
+			return "vsync";
+		case AdaptiveSync:
+			return "adaptive sync";
+		case Limited:
+			return "frame limiter";
+		default:
+			return "unlimited";
+		}
+	}
+
+	// Chamar logo antes de glfwSwapBuffers: no modo Limited segura o quadro até o prazo
+	void wait()
+	{
+		Clock::time_point now = Clock::now();
+		if (current == Limited)
+		{
+			auto frame = std::chrono::duration_cast<Clock::duration>(period);
+			// Quadro atrasado: o prazo recomeça agora (sem recuperar o atraso com quadros curtos)
+			deadline += frame;
+			if (deadline < now)
+				deadline = now;
+
+			Clock::time_point sleepUntil = deadline - std::chrono::duration_cast<Clock::duration>(spinMargin);
+			if (now < sleepUntil)
+			{
+				std::this_thread::sleep_until(sleepUntil);
+				// A margem acompanha o quanto o sleep passou do ponto
+				std::chrono::duration<double> overshoot = Clock::now() - sleepUntil;
+				if (overshoot > spinMargin * 0.5)
+					spinMargin = std::min(spinMargin * 1.5, maxSpinMargin);
+				else
+					spinMargin = std::max(spinMargin * 0.95, minSpinMargin);
+			}
+			while (Clock::now() < deadline)
+				std::this_thread::yield();
+			now = Clock::now();
+		}
+		if (lastPresent != Clock::time_point())
+			lastFrame = std::chrono::duration<double, std::milli>(now - lastPresent).count();
+		lastPresent = now;
+	}
+
+	// Intervalo entre as duas últimas entregas (milissegundos)
+	double frameMilliseconds() const { return lastFrame; }
+	double targetMilliseconds() const { return period.count() * 1000.0; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Mode current = VSync;
+	std::chrono::duration<double> period{1.0 / 60.0};
+	std::chrono::duration<double> spinMargin{0.002};
+	const std::chrono::duration<double> minSpinMargin{0.0005}, maxSpinMargin{0.004};
+	Clock::time_point deadline, lastPresent;
+	double lastFrame = 0.0;
+};
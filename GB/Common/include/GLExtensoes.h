@@ -0,0 +1,185 @@
+// Funções e constantes da OpenGL posteriores à versão 4.0
+//
+// O GLAD do projeto foi gerado para OpenGL 4.0, então as funções mais novas são
+// carregadas aqui pela GLFW. Cada ponteiro fica nulo quando o driver não oferece
+// a função, e quem usa deve verificar antes e cair no caminho antigo.
+
+#pragma once
+
+#include <cstring>
+
+//GLAD
+#include <glad/glad.h>
+
+// GLFW
+#include <GLFW/glfw3.h>
+
+// ARB_buffer_storage (4.4)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+// EXT_texture_compression_s3tc e ARB_texture_compression_bptc (4.2)
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+// KHR_parallel_shader_compile
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// ARB_get_program_binary (4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// ARB_program_interface_query (4.3)
+#ifndef GL_UNIFORM
+#define GL_UNIFORM 0x92E1
+#endif
+#ifndef GL_PROGRAM_INPUT
+#define GL_PROGRAM_INPUT 0x92E3
+#endif
+#ifndef GL_ACTIVE_RESOURCES
+#define GL_ACTIVE_RESOURCES 0x92F5
+#endif
+#ifndef GL_MAX_NAME_LENGTH
+#define GL_MAX_NAME_LENGTH 0x92F6
+#endif
+#ifndef GL_TYPE
+#define GL_TYPE 0x92FA
+#endif
+#ifndef GL_ARRAY_SIZE
+#define GL_ARRAY_SIZE 0x92FB
+#endif
+#ifndef GL_BLOCK_INDEX
+#define GL_BLOCK_INDEX 0x92FD
+#endif
+#ifndef GL_LOCATION
+#define GL_LOCATION 0x930E
+#endif
+
+// ARB_shader_storage_buffer_object (4.3)
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC_GLX)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC_GLX)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_GLX)(GLuint count);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_GLX)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_GLX)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_GLX)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLGETPROGRAMINTERFACEIVPROC_GLX)(GLuint program, GLenum programInterface, GLenum pname, GLint *params);
+typedef void (APIENTRYP PFNGLGETPROGRAMRESOURCENAMEPROC_GLX)(GLuint program, GLenum programInterface, GLuint index, GLsizei bufSize, GLsizei *length, GLchar *name);
+typedef void (APIENTRYP PFNGLGETPROGRAMRESOURCEIVPROC_GLX)(GLuint program, GLenum programInterface, GLuint index, GLsizei propCount, const GLenum *props, GLsizei count, GLsizei *length, GLint *params);
+typedef void (APIENTRYP PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC_GLX)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount, GLuint baseinstance);
+typedef void (APIENTRYP PFNGLDRAWELEMENTSINSTANCEDBASEINSTANCEPROC_GLX)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLuint baseinstance);
+typedef void (APIENTRYP PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC_GLX)(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLint basevertex, GLuint baseinstance);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC_GLX)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+namespace glx
+{
+	inline PFNGLTEXSTORAGE2DPROC_GLX TexStorage2D = nullptr;
+	inline PFNGLBUFFERSTORAGEPROC_GLX BufferStorage = nullptr;
+	inline PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_GLX MaxShaderCompilerThreads = nullptr;
+	inline PFNGLGETPROGRAMBINARYPROC_GLX GetProgramBinary = nullptr;
+	inline PFNGLPROGRAMBINARYPROC_GLX ProgramBinary = nullptr;
+	inline PFNGLPROGRAMPARAMETERIPROC_GLX ProgramParameteri = nullptr;
+	inline PFNGLGETPROGRAMINTERFACEIVPROC_GLX GetProgramInterfaceiv = nullptr;
+	inline PFNGLGETPROGRAMRESOURCENAMEPROC_GLX GetProgramResourceName = nullptr;
+	inline PFNGLGETPROGRAMRESOURCEIVPROC_GLX GetProgramResourceiv = nullptr;
+	inline PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC_GLX DrawArraysInstancedBaseInstance = nullptr;
+	inline PFNGLDRAWELEMENTSINSTANCEDBASEINSTANCEPROC_GLX DrawElementsInstancedBaseInstance = nullptr;
+	inline PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC_GLX DrawElementsInstancedBaseVertexBaseInstance = nullptr;
+	inline PFNGLMULTIDRAWELEMENTSINDIRECTPROC_GLX MultiDrawElementsIndirect = nullptr;
+
+	// Verifica se o contexto atual é pelo menos da versão major.minor
+	inline bool versionAtLeast(int major, int minor)
+	{
+		return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+	}
+
+	// Verifica se o driver anuncia a extensão (ex: "GL_ARB_buffer_storage")
+	inline bool hasExtension(const char *name)
+	{
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char *ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+			if (ext && strcmp(ext, name) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	template <typename T>
+	inline T loadFunction(const char *name)
+	{
+		return (T)glfwGetProcAddress(name);
+	}
+
+	// Carrega os ponteiros disponíveis. Deve ser chamado depois de gladLoadGLLoader.
+	inline void loadExtensions()
+	{
+		if (versionAtLeast(4, 2) || hasExtension("GL_ARB_texture_storage"))
+			TexStorage2D = loadFunction<PFNGLTEXSTORAGE2DPROC_GLX>("glTexStorage2D");
+		if (versionAtLeast(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+			BufferStorage = loadFunction<PFNGLBUFFERSTORAGEPROC_GLX>("glBufferStorage");
+		// Compilação de shaders em threads do driver; 0xFFFFFFFF deixa o driver escolher quantas
+		if (hasExtension("GL_KHR_parallel_shader_compile"))
+			MaxShaderCompilerThreads = loadFunction<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_GLX>("glMaxShaderCompilerThreadsKHR");
+		else if (hasExtension("GL_ARB_parallel_shader_compile"))
+			MaxShaderCompilerThreads = loadFunction<PFNGLMAXSHADERCOMPILERTHREADSKHRPROC_GLX>("glMaxShaderCompilerThreadsARB");
+		if (MaxShaderCompilerThreads)
+			MaxShaderCompilerThreads(0xFFFFFFFF);
+		if (versionAtLeast(4, 1) || hasExtension("GL_ARB_get_program_binary"))
+		{
+			GetProgramBinary = loadFunction<PFNGLGETPROGRAMBINARYPROC_GLX>("glGetProgramBinary");
+			ProgramBinary = loadFunction<PFNGLPROGRAMBINARYPROC_GLX>("glProgramBinary");
+			ProgramParameteri = loadFunction<PFNGLPROGRAMPARAMETERIPROC_GLX>("glProgramParameteri");
+		}
+		if (versionAtLeast(4, 3) || hasExtension("GL_ARB_program_interface_query"))
+		{
+			GetProgramInterfaceiv = loadFunction<PFNGLGETPROGRAMINTERFACEIVPROC_GLX>("glGetProgramInterfaceiv");
+			GetProgramResourceName = loadFunction<PFNGLGETPROGRAMRESOURCENAMEPROC_GLX>("glGetProgramResourceName");
+			GetProgramResourceiv = loadFunction<PFNGLGETPROGRAMRESOURCEIVPROC_GLX>("glGetProgramResourceiv");
+		}
+		if (versionAtLeast(4, 2) || hasExtension("GL_ARB_base_instance"))
+		{
+			DrawArraysInstancedBaseInstance = loadFunction<PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC_GLX>("glDrawArraysInstancedBaseInstance");
+			DrawElementsInstancedBaseInstance = loadFunction<PFNGLDRAWELEMENTSINSTANCEDBASEINSTANCEPROC_GLX>("glDrawElementsInstancedBaseInstance");
+			DrawElementsInstancedBaseVertexBaseInstance =
+				loadFunction<PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC_GLX>("glDrawElementsInstancedBaseVertexBaseInstance");
+		}
+		// O instanceCount/baseInstance dos comandos indiretos só é respeitado com ARB_base_instance
+		if ((versionAtLeast(4, 3) || hasExtension("GL_ARB_multi_draw_indirect")) && DrawElementsInstancedBaseVertexBaseInstance)
+			MultiDrawElementsIndirect = loadFunction<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_GLX>("glMultiDrawElementsIndirect");
+	}
+}
@@ -0,0 +1,354 @@
+// Cache do estado da OpenGL: descarta trocas de estado redundantes
+//
+// Guarda o último valor enviado de cada estado usado pelo laço de desenho (programa,
+// VAO, unidade de textura ativa e texturas de cada unidade, buffers por alvo, teste e
+// função de profundidade, máscaras de escrita, blending) e só chama a OpenGL quando
+// o valor muda.
+// Toda troca desses estados precisa passar por aqui, senão o cache fica desatualizado;
+// se algum código externo mexer no estado direto, chame invalidate() depois.
+// Objetos apagados devem ser avisados com forget*(), porque a OpenGL desvincula o
+// objeto e o nome pode ser reaproveitado por outro objeto criado depois.
+//
+// As chamadas emitidas e as descartadas são contadas por quadro (endFrame()).
+
+#pragma once
+
+#include <string>
+#include <sstream>
+#include <cstdint>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLExtensoes.h"
+
+struct GLStateStats
+{
+	unsigned long issued = 0;  // chamadas que chegaram na OpenGL
+	unsigned long skipped = 0; // chamadas redundantes descartadas
+};
+
+class GLStateCache
+{
+public:
+	static const int MAX_TEXTURE_UNITS = 32;
+
+	GLStateCache() { invalidate(); }
+
+	// Esquece tudo: a próxima troca de cada estado sempre chega na OpenGL
+	void invalidate()
+	{
+		program = UNKNOWN;
+		vertexArray = UNKNOWN;
+		activeUnit = UNKNOWN;
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+			for (int target = 0; target < TEXTURE_TARGETS; target++)
+				textures[unit][target] = UNKNOWN;
+		for (int target = 0; target < BUFFER_TARGETS; target++)
+			buffers[target] = UNKNOWN;
+		for (int cap = 0; cap < CAPABILITIES; cap++)
+			capabilities[cap] = -1;
+		depthFunction = UNKNOWN;
+		depthWrite = -1;
+		colorWrite = -1;
+		blendSrc = blendDst = UNKNOWN;
+	}
+
+	void useProgram(GLuint id)
+	{
+		if (changed(program, id))
+			glUseProgram(id);
+	}
+
+	// Trocar o VAO troca também o GL_ELEMENT_ARRAY_BUFFER (que faz parte do VAO)
+	void bindVertexArray(GLuint vao)
+	{
+		if (changed(vertexArray, vao))
+		{
+			glBindVertexArray(vao);
+			buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+		}
+	}
+
+	// unit: GL_TEXTURE0 + i
+	void activeTexture(GLenum unit)
+	{
+		if (changed(activeUnit, unit))
+			glActiveTexture(unit);
+	}
+
+	// Vincula na unidade ativa
+	void bindTexture(GLenum target, GLuint id)
+	{
+		int unit = activeUnit == UNKNOWN ? -1 : (int)(activeUnit - GL_TEXTURE0);
+		int t = textureIndex(target);
+		if (unit < 0 || unit >= MAX_TEXTURE_UNITS || t < 0)
+		{
+			// Unidade ou alvo fora do cache: sempre envia
+			frame.issued++;
+			glBindTexture(target, id);
+			return;
+		}
+		if (changed(textures[unit][t], id))
+			glBindTexture(target, id);
+	}
+
+	// Atalho: ativa a unidade e vincula a textura nela
+	void bindTextureUnit(GLenum unit, GLenum target, GLuint id)
+	{
+		activeTexture(unit);
+		bindTexture(target, id);
+	}
+
+	void bindBuffer(GLenum target, GLuint id)
+	{
+		int t = bufferIndex(target);
+		if (t < 0)
+		{
+			frame.issued++;
+			glBindBuffer(target, id);
+			return;
+		}
+		if (changed(buffers[t], id))
+			glBindBuffer(target, id);
+	}
+
+	// glBindBufferBase também troca o vínculo genérico do alvo; o ponto indexado
+	// não é guardado, então a chamada sempre é enviada
+	void bindBufferBase(GLenum target, GLuint index, GLuint id)
+	{
+		frame.issued++;
+		glBindBufferBase(target, index, id);
+		int t = bufferIndex(target);
+		if (t >= 0)
+			buffers[t] = id;
+	}
+
+	// Igual a bindBufferBase, para uma faixa do buffer
+	void bindBufferRange(GLenum target, GLuint index, GLuint id, GLintptr offset, GLsizeiptr size)
+	{
+		frame.issued++;
+		glBindBufferRange(target, index, id, offset, size);
+		int t = bufferIndex(target);
+		if (t >= 0)
+			buffers[t] = id;
+	}
+
+	void enable(GLenum cap) { setCapability(cap, true); }
+	void disable(GLenum cap) { setCapability(cap, false); }
+
+	void depthFunc(GLenum func)
+	{
+		if (changed(depthFunction, func))
+			glDepthFunc(func);
+	}
+
+	void depthMask(GLboolean flag)
+	{
+		int value = flag ? 1 : 0;
+		if (depthWrite == value)
+		{
+			frame.skipped++;
+			return;
+		}
+		depthWrite = value;
+		frame.issued++;
+		glDepthMask(flag);
+	}
+
+	// Os quatro canais juntos (a cena nunca mascara um canal só)
+	void colorMask(GLboolean flag)
+	{
+		int value = flag ? 1 : 0;
+		if (colorWrite == value)
+		{
+			frame.skipped++;
+			return;
+		}
+		colorWrite = value;
+		frame.issued++;
+		glColorMask(flag, flag, flag, flag);
+	}
+
+	void blendFunc(GLenum src, GLenum dst)
+	{
+		if (blendSrc == src && blendDst == dst)
+		{
+			frame.skipped++;
+			return;
+		}
+		blendSrc = src;
+		blendDst = dst;
+		frame.issued++;
+		glBlendFunc(src, dst);
+	}
+
+	// A OpenGL desvincula o objeto apagado de todos os pontos em que estava
+	void forgetTexture(GLuint id)
+	{
+		for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+			for (int target = 0; target < TEXTURE_TARGETS; target++)
+				if (textures[unit][target] == id)
+					textures[unit][target] = 0;
+	}
+
+	void forgetBuffer(GLuint id)
+	{
+		for (int target = 0; target < BUFFER_TARGETS; target++)
+			if (buffers[target] == id)
+				buffers[target] = 0;
+	}
+
+	void forgetVertexArray(GLuint vao)
+	{
+		if (vertexArray == vao)
+		{
+			vertexArray = 0;
+			buffers[bufferIndex(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+		}
+	}
+
+	void forgetProgram(GLuint id)
+	{
+		// Um programa em uso só é liberado quando outro é ativado; por segurança
+		// a próxima ativação de qualquer programa é enviada
+		if (program == id)
+			program = UNKNOWN;
+	}
+
+	// Fecha o quadro: guarda as contagens e zera para o próximo
+	void endFrame()
+	{
+		lastFrame = frame;
+		total.issued += frame.issued;
+		total.skipped += frame.skipped;
+		frame = GLStateStats();
+		frames++;
+	}
+
+	const GLStateStats &lastFrameStats() const { return lastFrame; }
+	const GLStateStats &currentFrameStats() const { return frame; }
+
+	std::string report() const
+	{
+		std::ostringstream out;
+		out << "GL state: last frame " << lastFrame.issued << " calls issued, " << lastFrame.skipped << " redundant dropped";
+		if (frames > 0)
+			out << " (average " << (double)total.issued / frames << " issued, " << (double)total.skipped / frames
+				<< " dropped per frame over " << frames << " frames)";
+		out << "\n";
+		return out.str();
+	}
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFFu;
+	static const int TEXTURE_TARGETS = 3;
+	static const int BUFFER_TARGETS = 10;
+	static const int CAPABILITIES = 4;
+
+	GLuint program, vertexArray, activeUnit;
+	GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint buffers[BUFFER_TARGETS];
+	int capabilities[CAPABILITIES]; // -1 desconhecido, 0 desligado, 1 ligado
+	GLuint depthFunction;
+	int depthWrite;
+	int colorWrite;
+	GLuint blendSrc, blendDst;
+
+	GLStateStats frame, lastFrame, total;
+	unsigned long frames = 0;
+
+	// Atualiza o valor guardado e conta a chamada; false se ela é redundante
+	bool changed(GLuint &current, GLuint value)
+	{
+		if (current == value)
+		{
+			frame.skipped++;
+			return false;
+		}
+		current = value;
+		frame.issued++;
+		return true;
+	}
+
+	static int textureIndex(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_TEXTURE_2D:
+			return 0;
+		case GL_TEXTURE_2D_ARRAY:
+			return 1;
+		case GL_TEXTURE_CUBE_MAP:
+			return 2;
+		default:
+			return -1;
+		}
+	}
+
+	static int bufferIndex(GLenum target)
+	{
+		switch (target)
+		{
+		case GL_ARRAY_BUFFER:
+			return 0;
+		case GL_ELEMENT_ARRAY_BUFFER:
+			return 1;
+		case GL_UNIFORM_BUFFER:
+			return 2;
+		case GL_PIXEL_UNPACK_BUFFER:
+			return 3;
+		case GL_PIXEL_PACK_BUFFER:
+			return 4;
+		case GL_COPY_READ_BUFFER:
+			return 5;
+		case GL_COPY_WRITE_BUFFER:
+			return 6;
+		case GL_DRAW_INDIRECT_BUFFER:
+			return 7;
+		case GL_TEXTURE_BUFFER:
+			return 8;
+		case GL_SHADER_STORAGE_BUFFER:
+			return 9;
+		default:
+			return -1;
+		}
+	}
+
+	static int capabilityIndex(GLenum cap)
+	{
+		switch (cap)
+		{
+		case GL_DEPTH_TEST:
+			return 0;
+		case GL_BLEND:
+			return 1;
+		case GL_CULL_FACE:
+			return 2;
+		case GL_SCISSOR_TEST:
+			return 3;
+		default:
+			return -1;
+		}
+	}
+
+	void setCapability(GLenum cap, bool on)
+	{
+		int c = capabilityIndex(cap);
+		if (c >= 0 && capabilities[c] == (on ? 1 : 0))
+		{
+			frame.skipped++;
+			return;
+		}
+		if (c >= 0)
+			capabilities[c] = on ? 1 : 0;
+		frame.issued++;
+		if (on)
+			glEnable(cap);
+		else
+			glDisable(cap);
+	}
+};
+
+// Um único contexto OpenGL na aplicação, então um único cache
+inline GLStateCache glState;
@@ -0,0 +1,311 @@
+// Buffers de vértices e índices compartilhados por todas as malhas de um formato
+//
+// Em vez de um VBO e um VAO por malha, cada formato de vértice (VertexLayout) tem um
+// buffer grande de vértices, um de índices e um único VAO. As malhas viram faixas
+// (primeiro vértice/quantidade, primeiro índice/quantidade) reservadas por um
+// BuddyAllocator, então desenhar malhas diferentes não troca de VAO e várias malhas
+// podem ir num mesmo multi-draw. Os índices de cada malha são relativos ao primeiro
+// vértice dela (glDrawElementsBaseVertex).
+//
+// Quando falta espaço os buffers dobram de tamanho (cópia na GPU). defragment()
+// reempacota as faixas vivas, da maior para a menor, em buffers novos; as malhas são
+// referenciadas por handle, então quem desenha consulta range() e sempre vê a faixa atual.
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "BuddyAllocator.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+
+// Faixa de uma malha dentro dos buffers do pool
+struct MeshRange
+{
+	GLint firstVertex = 0;
+	GLsizei vertexCount = 0;
+	GLuint firstIndex = 0;
+	GLsizei indexCount = 0;
+};
+
+template <typename Layout>
+class GeometryPool
+{
+public:
+	using Handle = uint32_t;
+	static const Handle INVALID_HANDLE = 0xFFFFFFFFu;
+
+	// Capacidades iniciais em vértices e índices (crescem sob demanda).
+	// Com registro, os buffers ficam associados ao VAO: releaseVertexArray(vao()) apaga tudo.
+	void create(size_t vertexCapacity, size_t indexCapacity, GpuMemoryRegistry *registry = nullptr,
+				const std::string &name = "geometry pool")
+	{
+		this->registry = registry;
+		this->name = name;
+		vertexAllocator.reset(vertexCapacity);
+		indexAllocator.reset(indexCapacity);
+		glGenVertexArrays(1, &vertexArray);
+		vertexBuffer = createBuffer(GL_ARRAY_BUFFER, vertexAllocator.capacity() * Layout::stride, " vertices");
+		indexBuffer = createBuffer(GL_ELEMENT_ARRAY_BUFFER, indexAllocator.capacity() * sizeof(GLuint), " indices");
+		configureVertexArray();
+	}
+
+	// Copia a malha para o pool. Os índices (opcionais) são relativos ao primeiro vértice da malha.
+	Handle add(const void *vertices, size_t vertexCount, const GLuint *indices = nullptr, size_t indexCount = 0)
+	{
+		Mesh mesh;
+		mesh.live = true;
+		mesh.vertexCount = vertexCount;
+		mesh.indexCount = indexCount;
+		mesh.vertexOffset = reserve(vertexAllocator, vertexBuffer, GL_ARRAY_BUFFER, Layout::stride, vertexCount, " vertices");
+		if (indexCount)
+			mesh.indexOffset = reserve(indexAllocator, indexBuffer, GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint), indexCount, " indices");
+
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.vertexOffset * Layout::stride, vertexCount * Layout::stride, vertices);
+		if (indexCount)
+		{
+			glState.bindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+			glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.indexOffset * sizeof(GLuint), indexCount * sizeof(GLuint), indices);
+		}
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+		Handle handle;
+		if (!freeHandles.empty())
+		{
+			handle = freeHandles.back();
+			freeHandles.pop_back();
+			meshes[handle] = mesh;
+		}
+		else
+		{
+			handle = (Handle)meshes.size();
+			meshes.push_back(mesh);
+		}
+		return handle;
+	}
+
+	void remove(Handle handle)
+	{
+		if (handle >= meshes.size() || !meshes[handle].live)
+			return;
+		Mesh &mesh = meshes[handle];
+		vertexAllocator.release(mesh.vertexOffset);
+		if (mesh.indexCount)
+			indexAllocator.release(mesh.indexOffset);
+		mesh = Mesh();
+		freeHandles.push_back(handle);
+	}
+
+	MeshRange range(Handle handle) const
+	{
+		MeshRange r;
+		if (handle >= meshes.size() || !meshes[handle].live)
+			return r;
+		const Mesh &mesh = meshes[handle];
+		r.firstVertex = (GLint)mesh.vertexOffset;
+		r.vertexCount = (GLsizei)mesh.vertexCount;
+		r.firstIndex = (GLuint)mesh.indexOffset;
+		r.indexCount = (GLsizei)mesh.indexCount;
+		return r;
+	}
+
+	// VAO compartilhado por todas as malhas do pool
+	GLuint vao() const { return vertexArray; }
+
+	// VAOs extras que leem os mesmos buffers (ex: com atributos por instância além dos
+	// do vértice). O pool reaponta esses VAOs sempre que troca os buffers.
+	void attach(GLuint vao)
+	{
+		attached.push_back(vao);
+		configure(vao);
+	}
+
+	void detach(GLuint vao)
+	{
+		attached.erase(std::remove(attached.begin(), attached.end(), vao), attached.end());
+	}
+
+	// Reempacota as malhas vivas em buffers novos. Retorna quantas faixas mudaram de lugar.
+	int defragment()
+	{
+		std::vector<Handle> live;
+		for (Handle h = 0; h < meshes.size(); h++)
+			if (meshes[h].live)
+				live.push_back(h);
+		// Maiores primeiro: no buddy isso deixa os blocos lado a lado, sem buracos
+		std::sort(live.begin(), live.end(), [this](Handle a, Handle b) { return meshes[a].vertexCount > meshes[b].vertexCount; });
+
+		BuddyAllocator vertices, indices;
+		vertices.reset(vertexAllocator.capacity());
+		indices.reset(indexAllocator.capacity());
+		std::vector<size_t> newVertex(meshes.size()), newIndex(meshes.size());
+		for (Handle h : live)
+		{
+			newVertex[h] = allocateGrowing(vertices, meshes[h].vertexCount);
+			if (meshes[h].indexCount)
+				newIndex[h] = allocateGrowing(indices, meshes[h].indexCount);
+		}
+
+		GLuint newVertexBuffer = createBuffer(GL_ARRAY_BUFFER, vertices.capacity() * Layout::stride, " vertices");
+		GLuint newIndexBuffer = createBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.capacity() * sizeof(GLuint), " indices");
+		int moved = 0;
+		for (Handle h : live)
+		{
+			Mesh &mesh = meshes[h];
+			copyRange(vertexBuffer, newVertexBuffer, mesh.vertexOffset * Layout::stride, newVertex[h] * Layout::stride,
+					  mesh.vertexCount * Layout::stride);
+			if (mesh.indexCount)
+				copyRange(indexBuffer, newIndexBuffer, mesh.indexOffset * sizeof(GLuint), newIndex[h] * sizeof(GLuint),
+						  mesh.indexCount * sizeof(GLuint));
+			if (newVertex[h] != mesh.vertexOffset || (mesh.indexCount && newIndex[h] != mesh.indexOffset))
+				moved++;
+			mesh.vertexOffset = newVertex[h];
+			mesh.indexOffset = mesh.indexCount ? newIndex[h] : 0;
+		}
+
+		deleteBuffer(vertexBuffer);
+		deleteBuffer(indexBuffer);
+		vertexBuffer = newVertexBuffer;
+		indexBuffer = newIndexBuffer;
+		vertexAllocator = vertices;
+		indexAllocator = indices;
+		configureVertexArray();
+		return moved;
+	}
+
+	// Parte livre que não cabe no maior bloco livre (0 = nada fragmentado)
+	double fragmentation() const
+	{
+		size_t freeUnits = vertexAllocator.capacity() - vertexAllocator.used();
+		if (freeUnits == 0)
+			return 0.0;
+		return 1.0 - (double)vertexAllocator.largestFree() / freeUnits;
+	}
+
+	std::string report() const
+	{
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(2);
+		out << name << ": " << vertexAllocator.allocations() << " meshes, vertices " << vertexAllocator.used() << "/"
+			<< vertexAllocator.capacity() << ", indices " << indexAllocator.used() << "/" << indexAllocator.capacity()
+			<< ", fragmentation " << fragmentation() * 100.0 << "%\n";
+		return out.str();
+	}
+
+	void destroy()
+	{
+		deleteBuffer(vertexBuffer);
+		deleteBuffer(indexBuffer);
+		if (vertexArray)
+		{
+			glState.forgetVertexArray(vertexArray);
+			glDeleteVertexArrays(1, &vertexArray);
+		}
+		vertexBuffer = indexBuffer = vertexArray = 0;
+		attached.clear();
+		meshes.clear();
+		freeHandles.clear();
+	}
+
+private:
+	struct Mesh
+	{
+		bool live = false;
+		size_t vertexOffset = 0, vertexCount = 0;
+		size_t indexOffset = 0, indexCount = 0;
+	};
+
+	std::vector<Mesh> meshes;
+	std::vector<Handle> freeHandles;
+	std::vector<GLuint> attached;
+	BuddyAllocator vertexAllocator, indexAllocator;
+	GLuint vertexArray = 0, vertexBuffer = 0, indexBuffer = 0;
+	GpuMemoryRegistry *registry = nullptr;
+	std::string name;
+
+	GLuint createBuffer(GLenum target, size_t bytes, const char *suffix)
+	{
+		GLuint id;
+		glGenBuffers(1, &id);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, id);
+		glBufferData(GL_COPY_WRITE_BUFFER, bytes, NULL, GL_STATIC_DRAW);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (registry)
+			registry->trackBuffer(id, target, bytes, GpuSubsystem::Geometry, name + suffix, vertexArray);
+		return id;
+	}
+
+	void deleteBuffer(GLuint id)
+	{
+		if (!id)
+			return;
+		if (registry)
+			registry->release(GpuResourceType::Buffer, id);
+		else
+		{
+			glState.forgetBuffer(id);
+			glDeleteBuffers(1, &id);
+		}
+	}
+
+	static void copyRange(GLuint from, GLuint to, size_t fromOffset, size_t toOffset, size_t bytes)
+	{
+		glState.bindBuffer(GL_COPY_READ_BUFFER, from);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, to);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, fromOffset, toOffset, bytes);
+		glState.bindBuffer(GL_COPY_READ_BUFFER, 0);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	static size_t allocateGrowing(BuddyAllocator &allocator, size_t count)
+	{
+		size_t offset;
+		while ((offset = allocator.allocate(count)) == BuddyAllocator::INVALID)
+			allocator.grow();
+		return offset;
+	}
+
+	// Reserva a faixa, dobrando o buffer (com cópia do conteúdo) até ela caber
+	size_t reserve(BuddyAllocator &allocator, GLuint &buffer, GLenum target, size_t unitBytes, size_t count, const char *suffix)
+	{
+		size_t offset = allocator.allocate(count);
+		if (offset != BuddyAllocator::INVALID)
+			return offset;
+
+		size_t oldBytes = allocator.capacity() * unitBytes;
+		offset = allocateGrowing(allocator, count);
+		GLuint grown = createBuffer(target, allocator.capacity() * unitBytes, suffix);
+		copyRange(buffer, grown, 0, 0, oldBytes);
+		deleteBuffer(buffer);
+		buffer = grown;
+		configureVertexArray();
+		return offset;
+	}
+
+	// Aponta os VAOs para os buffers atuais
+	void configureVertexArray()
+	{
+		configure(vertexArray);
+		for (GLuint vao : attached)
+			configure(vao);
+	}
+
+	void configure(GLuint vao)
+	{
+		glState.bindVertexArray(vao);
+		glState.bindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		Layout::setup();
+		glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glState.bindVertexArray(0);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
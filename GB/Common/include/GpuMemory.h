@@ -0,0 +1,372 @@
+// Registro central dos recursos alocados na GPU (buffers e texturas)
+//
+// Cada recurso é contabilizado em bytes e marcado com o subsistema que o criou.
+// Buffers podem ser associados ao VAO que os usa, para serem liberados junto com ele.
+// Buffers "recarregáveis" informam como refazer seus dados: quando o total passa do
+// orçamento, os menos usados recentemente (LRU) têm o armazenamento liberado (o nome
+// GL continua válido, então os VAOs não mudam) e são recarregados no próximo uso.
+// Recursos que sabem devolver só parte da memória (ex: as texturas do TextureStreamer,
+// que descartam os mipmaps mais finos) informam uma função de redução, chamada na
+// mesma ordem LRU. O uso é marcado com touch()/touchVertexArray() nos desenhos.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLStateCache.h"
+
+enum class GpuSubsystem
+{
+	Geometry,		  // malhas dos modelos
+	Debug,			  // curvas, grade, eixos
+	Textures,		  // texturas carregadas inteiras
+	TextureStreaming, // texturas com mipmaps sob demanda
+	Upload,			  // buffers de envio
+	Uniforms,		  // blocos de uniforms compartilhados
+	Count
+};
+
+inline const char *gpuSubsystemName(GpuSubsystem subsystem)
+{
+	switch (subsystem)
+	{
+	case GpuSubsystem::Geometry:
+		return "geometry";
+	case GpuSubsystem::Debug:
+		return "debug";
+	case GpuSubsystem::Textures:
+		return "textures";
+	case GpuSubsystem::TextureStreaming:
+		return "texture-streaming";
+	case GpuSubsystem::Upload:
+		return "upload";
+	case GpuSubsystem::Uniforms:
+		return "uniforms";
+	default:
+		return "?";
+	}
+}
+
+enum class GpuResourceType
+{
+	Buffer,
+	Texture
+};
+
+// Totais atuais, para monitoramento
+struct GpuMemoryStats
+{
+	size_t totalBytes = 0;
+	size_t peakBytes = 0;
+	size_t budget = 0;
+	size_t bytesBySubsystem[(int)GpuSubsystem::Count] = {};
+	int countBySubsystem[(int)GpuSubsystem::Count] = {};
+	int evictions = 0;
+	int reloads = 0;
+};
+
+class GpuMemoryRegistry
+{
+public:
+	// Função que refaz o conteúdo de um buffer descartado. Deve apenas reenviar os dados
+	// (chamando resize se o tamanho mudar), sem registrar o buffer de novo.
+	using ReloadFn = std::function<void()>;
+	// Função que devolve até "excess" bytes do recurso, informando o novo tamanho com resize
+	using ShrinkFn = std::function<void(size_t excess)>;
+
+	// Orçamento para o total registrado (bytes)
+	size_t budget = 512u * 1024u * 1024u;
+
+	// Registra um buffer ("target" é só informativo: onde o buffer é usado)
+	void trackBuffer(GLuint id, GLenum target, size_t bytes, GpuSubsystem subsystem, const std::string &name,
+					 GLuint ownerVAO = 0, ReloadFn reload = nullptr)
+	{
+		track(GpuResourceType::Buffer, id, target, bytes, subsystem, name, ownerVAO, reload);
+	}
+
+	// Recarga que reenvia uma cópia dos dados guardada na CPU
+	// (GL_COPY_WRITE_BUFFER não altera o estado de nenhum VAO)
+	template <typename T>
+	static ReloadFn reupload(GLuint id, std::vector<T> data)
+	{
+		return [id, data = std::move(data)]() {
+			glState.bindBuffer(GL_COPY_WRITE_BUFFER, id);
+			glBufferData(GL_COPY_WRITE_BUFFER, data.size() * sizeof(T), data.data(), GL_STATIC_DRAW);
+			glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		};
+	}
+
+	void trackTexture(GLuint id, size_t bytes, GpuSubsystem subsystem, const std::string &name,
+					  ShrinkFn shrink = nullptr)
+	{
+		track(GpuResourceType::Texture, id, GL_TEXTURE_2D, bytes, subsystem, name, 0, nullptr);
+		if (shrink)
+			resources[key(GpuResourceType::Texture, id)].shrink = shrink;
+	}
+
+	// Atualiza o tamanho de um recurso já registrado (ex: nível de mipmap enviado ou descartado)
+	void resize(GpuResourceType type, GLuint id, size_t bytes)
+	{
+		auto it = resources.find(key(type, id));
+		if (it == resources.end())
+			return;
+		Resource &res = it->second;
+		if (res.resident)
+		{
+			subtract(res);
+			res.bytes = bytes;
+			add(res);
+		}
+		else
+		{
+			res.bytes = bytes;
+		}
+	}
+
+	// Marca o recurso como usado neste quadro, recarregando-o se tiver sido descartado
+	void touch(GpuResourceType type, GLuint id)
+	{
+		auto it = resources.find(key(type, id));
+		if (it != resources.end())
+			use(it->second);
+	}
+
+	// Marca todos os buffers associados ao VAO
+	void touchVertexArray(GLuint vao)
+	{
+		auto it = buffersByVAO.find(vao);
+		if (it == buffersByVAO.end())
+			return;
+		for (GLuint id : it->second)
+			touch(GpuResourceType::Buffer, id);
+	}
+
+	// Tira do registro sem apagar o objeto GL
+	void untrack(GpuResourceType type, GLuint id)
+	{
+		auto it = resources.find(key(type, id));
+		if (it == resources.end())
+			return;
+		Resource &res = it->second;
+		if (res.resident)
+			subtract(res);
+		if (res.ownerVAO)
+		{
+			std::vector<GLuint> &owned = buffersByVAO[res.ownerVAO];
+			owned.erase(std::remove(owned.begin(), owned.end(), id), owned.end());
+			if (owned.empty())
+				buffersByVAO.erase(res.ownerVAO);
+		}
+		resources.erase(it);
+	}
+
+	// Apaga o objeto GL e tira do registro
+	void release(GpuResourceType type, GLuint id)
+	{
+		untrack(type, id);
+		if (type == GpuResourceType::Buffer)
+		{
+			glState.forgetBuffer(id);
+			glDeleteBuffers(1, &id);
+		}
+		else
+		{
+			glState.forgetTexture(id);
+			glDeleteTextures(1, &id);
+		}
+	}
+
+	// Apaga o VAO junto com todos os buffers associados a ele
+	void releaseVertexArray(GLuint vao)
+	{
+		auto it = buffersByVAO.find(vao);
+		if (it != buffersByVAO.end())
+		{
+			std::vector<GLuint> owned = it->second;
+			for (GLuint id : owned)
+				release(GpuResourceType::Buffer, id);
+		}
+		glState.forgetVertexArray(vao);
+		glDeleteVertexArrays(1, &vao);
+	}
+
+	// Apaga tudo o que ainda está registrado (fim da aplicação)
+	void releaseAll()
+	{
+		std::vector<GLuint> vaos;
+		for (auto &entry : buffersByVAO)
+			vaos.push_back(entry.first);
+		for (GLuint vao : vaos)
+			releaseVertexArray(vao);
+
+		std::vector<std::pair<GpuResourceType, GLuint>> rest;
+		for (auto &entry : resources)
+			rest.push_back({entry.second.type, entry.second.id});
+		for (auto &r : rest)
+			release(r.first, r.second);
+	}
+
+	// Fim do quadro: aplica o orçamento descartando (ou reduzindo) os menos usados
+	void endFrame()
+	{
+		if (stats.totalBytes > budget)
+		{
+			std::vector<Resource *> lru;
+			for (auto &entry : resources)
+			{
+				Resource &res = entry.second;
+				if (res.resident && (res.reload || res.shrink) && res.lastUsedFrame != frame)
+					lru.push_back(&res);
+			}
+			std::sort(lru.begin(), lru.end(), [](const Resource *a, const Resource *b) {
+				return a->lastUsedFrame < b->lastUsedFrame;
+			});
+			for (Resource *res : lru)
+			{
+				if (stats.totalBytes <= budget)
+					break;
+				if (res->reload)
+				{
+					evict(*res);
+				}
+				else
+				{
+					size_t before = stats.totalBytes;
+					res->shrink(stats.totalBytes - budget);
+					if (stats.totalBytes < before)
+						stats.evictions++;
+				}
+			}
+		}
+		frame++;
+	}
+
+	const GpuMemoryStats &getStats() const
+	{
+		stats.budget = budget;
+		return stats;
+	}
+
+	// Relatório em texto: totais por subsistema e os maiores recursos
+	std::string report(int topResources = 5) const
+	{
+		std::ostringstream out;
+		out << std::fixed << std::setprecision(2);
+		out << "GPU memory: " << toMB(stats.totalBytes) << " MB / " << toMB(budget) << " MB"
+			<< " (peak " << toMB(stats.peakBytes) << " MB, evictions " << stats.evictions
+			<< ", reloads " << stats.reloads << ")\n";
+		for (int i = 0; i < (int)GpuSubsystem::Count; i++)
+			if (stats.countBySubsystem[i])
+				out << "  " << std::left << std::setw(18) << gpuSubsystemName((GpuSubsystem)i) << std::right
+					<< std::setw(10) << toMB(stats.bytesBySubsystem[i]) << " MB  (" << stats.countBySubsystem[i] << ")\n";
+
+		std::vector<const Resource *> sorted;
+		for (auto &entry : resources)
+			sorted.push_back(&entry.second);
+		std::sort(sorted.begin(), sorted.end(), [](const Resource *a, const Resource *b) {
+			return a->bytes > b->bytes;
+		});
+		for (int i = 0; i < topResources && i < (int)sorted.size(); i++)
+			out << "  - " << sorted[i]->name << ": " << toMB(sorted[i]->bytes) << " MB"
+				<< (sorted[i]->resident ? "" : " (evicted)") << "\n";
+		return out.str();
+	}
+
+private:
+	struct Resource
+	{
+		GpuResourceType type;
+		GLuint id;
+		GLenum target;
+		size_t bytes;
+		GpuSubsystem subsystem;
+		std::string name;
+		GLuint ownerVAO;
+		ReloadFn reload;
+		ShrinkFn shrink;
+		bool resident = true;
+		unsigned long lastUsedFrame = 0;
+	};
+
+	std::unordered_map<unsigned long long, Resource> resources;
+	std::unordered_map<GLuint, std::vector<GLuint>> buffersByVAO;
+	mutable GpuMemoryStats stats;
+	unsigned long frame = 0;
+
+	static unsigned long long key(GpuResourceType type, GLuint id)
+	{
+		return ((unsigned long long)type << 32) | id;
+	}
+
+	static double toMB(size_t bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+
+	void track(GpuResourceType type, GLuint id, GLenum target, size_t bytes, GpuSubsystem subsystem,
+			   const std::string &name, GLuint ownerVAO, ReloadFn reload)
+	{
+		untrack(type, id);
+		Resource res;
+		res.type = type;
+		res.id = id;
+		res.target = target;
+		res.bytes = bytes;
+		res.subsystem = subsystem;
+		res.name = name;
+		res.ownerVAO = ownerVAO;
+		res.reload = reload;
+		res.lastUsedFrame = frame;
+		add(res);
+		resources[key(type, id)] = res;
+		if (ownerVAO)
+			buffersByVAO[ownerVAO].push_back(id);
+	}
+
+	void add(const Resource &res)
+	{
+		stats.totalBytes += res.bytes;
+		stats.peakBytes = std::max(stats.peakBytes, stats.totalBytes);
+		stats.bytesBySubsystem[(int)res.subsystem] += res.bytes;
+		stats.countBySubsystem[(int)res.subsystem]++;
+	}
+
+	void subtract(const Resource &res)
+	{
+		stats.totalBytes -= res.bytes;
+		stats.bytesBySubsystem[(int)res.subsystem] -= res.bytes;
+		stats.countBySubsystem[(int)res.subsystem]--;
+	}
+
+	// Libera o armazenamento do buffer mantendo o nome GL
+	// (GL_COPY_WRITE_BUFFER não altera o estado de nenhum VAO)
+	void evict(Resource &res)
+	{
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, res.id);
+		glBufferData(GL_COPY_WRITE_BUFFER, 0, NULL, GL_STATIC_DRAW);
+		glState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		subtract(res);
+		res.resident = false;
+		stats.evictions++;
+	}
+
+	void use(Resource &res)
+	{
+		res.lastUsedFrame = frame;
+		if (res.resident)
+			return;
+		res.resident = true;
+		add(res);
+		stats.reloads++;
+		res.reload();
+	}
+};
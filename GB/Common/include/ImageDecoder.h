@@ -0,0 +1,504 @@
+// Decodificação de imagens para RGBA8 com backend escolhível
+//
+// - StbImage: stb_image (padrão). No x64 o stb já usa SSE2 na IDCT e na conversão YCbCr->RGB.
+// - LibJpegTurbo: libjpeg-turbo para JPEG, com IDCT, upsampling e conversão de cor em
+//   SSE2/AVX2 escolhidos em tempo de execução. Para habilitar, compile com
+//   -DUSE_LIBJPEG_TURBO e ligue com -ljpeg (no MSYS2: mingw-w64-ucrt-x86_64-libjpeg-turbo).
+//
+// Com libjpeg-turbo a imagem é decodificada direto no destino devolvido pelo alocador.
+// O stb_image sempre devolve um buffer próprio, então nesse backend (e para PNG e outros
+// formatos, que sempre passam pelo stb_image) há uma cópia a mais da imagem inteira.
+//
+// Opcionalmente (imageDecoderParallelRestart), quando o JPEG tem intervalos de reinício
+// (marcador DRI) alinhados às linhas de MCU, a imagem é cortada em faixas horizontais
+// independentes, decodificadas em paralelo pelas threads de um ImageDecoderPool. Cada
+// faixa escreve nas suas linhas do destino. Como o upsampling do croma não enxerga a
+// faixa vizinha, a linha de borda entre faixas pode variar alguns tons; por isso vem
+// desligado. Se alguma faixa falhar, a imagem é decodificada inteira.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+//STB_IMAGE
+#include <stb_image.h>
+
+#ifdef USE_LIBJPEG_TURBO
+#include <cstdio>
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+enum class ImageDecoderBackend
+{
+	StbImage,
+	LibJpegTurbo
+};
+
+#ifdef USE_LIBJPEG_TURBO
+inline ImageDecoderBackend imageDecoderBackend = ImageDecoderBackend::LibJpegTurbo;
+#else
+inline ImageDecoderBackend imageDecoderBackend = ImageDecoderBackend::StbImage;
+#endif
+
+// Liga/desliga a decodificação em faixas pelos intervalos de reinício (bordas podem variar)
+inline bool imageDecoderParallelRestart = false;
+
+// Recebe largura e altura e devolve onde escrever os w*h*4 bytes RGBA8
+using ImageAllocator = std::function<unsigned char *(int width, int height)>;
+
+// Conjunto fixo de threads para as faixas de JPEG. Quem chama run() também decodifica
+// faixas enquanto espera, então várias threads podem usar o mesmo conjunto ao mesmo
+// tempo sem criar threads novas por imagem.
+class ImageDecoderPool
+{
+public:
+	explicit ImageDecoderPool(int numThreads = 0)
+	{
+		if (numThreads <= 0)
+			numThreads = std::max(0, std::min(4, (int)std::thread::hardware_concurrency() - 1));
+		for (int i = 0; i < numThreads; i++)
+			threads.emplace_back(&ImageDecoderPool::threadLoop, this);
+	}
+
+	~ImageDecoderPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		cond.notify_all();
+		for (std::thread &t : threads)
+			t.join();
+	}
+
+	ImageDecoderPool(const ImageDecoderPool &) = delete;
+	ImageDecoderPool &operator=(const ImageDecoderPool &) = delete;
+
+	int threadCount() const { return (int)threads.size(); }
+
+	// Executa task(0) ... task(count - 1) e retorna quando todas terminarem
+	void run(int count, const std::function<void(int)> &task)
+	{
+		Batch batch{&task, 0};
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (int i = 0; i < count; i++)
+				jobs.push_back({&batch, i});
+		}
+		cond.notify_all();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		while (batch.done < count)
+		{
+			// Ajuda com qualquer faixa pendente (nenhuma delas bloqueia)
+			if (!jobs.empty())
+			{
+				Job job = jobs.front();
+				jobs.pop_front();
+				execute(job, lock);
+			}
+			else
+				cond.wait(lock);
+		}
+	}
+
+private:
+	struct Batch
+	{
+		const std::function<void(int)> *task;
+		int done;
+	};
+	struct Job
+	{
+		Batch *batch;
+		int index;
+	};
+
+	std::vector<std::thread> threads;
+	std::deque<Job> jobs;
+	std::mutex mutex;
+	std::condition_variable cond;
+	bool stopping = false;
+
+	// Chamado com o mutex travado; destrava durante a tarefa
+	void execute(const Job &job, std::unique_lock<std::mutex> &lock)
+	{
+		lock.unlock();
+		(*job.batch->task)(job.index);
+		lock.lock();
+		job.batch->done++;
+		cond.notify_all();
+	}
+
+	void threadLoop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			cond.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			Job job = jobs.front();
+			jobs.pop_front();
+			execute(job, lock);
+		}
+	}
+};
+
+namespace imagedecoder
+{
+	inline bool readFile(const std::string &path, std::vector<unsigned char> &bytes)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		file.seekg(0, std::ios::end);
+		std::streamoff size = file.tellg();
+		if (size < 0)
+			return false;
+		bytes.resize((size_t)size);
+		file.seekg(0, std::ios::beg);
+		file.read((char *)bytes.data(), bytes.size());
+		return (bool)file;
+	}
+
+	inline bool isJPEG(const std::vector<unsigned char> &bytes)
+	{
+		return bytes.size() > 4 && bytes[0] == 0xFF && bytes[1] == 0xD8;
+	}
+
+	inline int readU16(const unsigned char *p)
+	{
+		return (p[0] << 8) | p[1];
+	}
+
+	// Estrutura de um JPEG sequencial, o suficiente para cortá-lo nos marcadores RST
+	struct JpegLayout
+	{
+		int width = 0, height = 0;
+		int mcuWidth = 8, mcuHeight = 8; // tamanho da MCU em pixels
+		int mcusPerRow = 0, mcuRows = 0;
+		int restartInterval = 0;		 // MCUs por intervalo (0 = sem reinício)
+		size_t heightOffset = 0;		 // posição do campo de altura no SOF
+		size_t scanStart = 0;			 // primeiro byte dos dados entrópicos
+		// Início e fim (exclusivo) dos dados de cada intervalo, sem os marcadores RST
+		std::vector<std::pair<size_t, size_t>> intervals;
+	};
+
+	// Lê os segmentos até o SOS e localiza os intervalos de reinício.
+	// Falha para JPEG progressivo, com várias varreduras ou sem DRI.
+	inline bool parseJpegLayout(const std::vector<unsigned char> &bytes, JpegLayout &layout)
+	{
+		const unsigned char *d = bytes.data();
+		size_t n = bytes.size();
+		size_t pos = 2;
+		int numComponents = 0, hMax = 1, vMax = 1;
+		bool haveFrame = false;
+
+		while (pos + 4 <= n)
+		{
+			if (d[pos] != 0xFF)
+				return false;
+			int marker = d[pos + 1];
+			if (marker == 0xFF)
+			{
+				pos++;
+				continue;
+			}
+			size_t length = readU16(d + pos + 2);
+			if (pos + 2 + length > n)
+				return false;
+
+			if (marker == 0xC0 || marker == 0xC1) // baseline / sequencial estendido
+			{
+				layout.heightOffset = pos + 5;
+				layout.height = readU16(d + pos + 5);
+				layout.width = readU16(d + pos + 7);
+				numComponents = d[pos + 9];
+				for (int c = 0; c < numComponents; c++)
+				{
+					int sampling = d[pos + 11 + c * 3];
+					hMax = std::max(hMax, sampling >> 4);
+					vMax = std::max(vMax, sampling & 15);
+				}
+				haveFrame = true;
+			}
+			else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+				return false; // progressivo, sem perdas ou aritmético
+			}
+			else if (marker == 0xDD)
+			{
+				layout.restartInterval = readU16(d + pos + 4);
+			}
+			else if (marker == 0xDA)
+			{
+				// A varredura precisa conter todos os componentes (intercalada)
+				if (!haveFrame || d[pos + 4] != numComponents)
+					return false;
+				layout.scanStart = pos + 2 + length;
+				break;
+			}
+			pos += 2 + length;
+		}
+		if (!haveFrame || layout.scanStart == 0 || layout.restartInterval == 0 || layout.height == 0)
+			return false;
+
+		if (numComponents > 1)
+		{
+			layout.mcuWidth = 8 * hMax;
+			layout.mcuHeight = 8 * vMax;
+		}
+		layout.mcusPerRow = (layout.width + layout.mcuWidth - 1) / layout.mcuWidth;
+		layout.mcuRows = (layout.height + layout.mcuHeight - 1) / layout.mcuHeight;
+
+		// Percorre os dados entrópicos separando os intervalos nos marcadores RST
+		size_t start = layout.scanStart;
+		for (pos = layout.scanStart; pos + 1 < n; pos++)
+		{
+			if (d[pos] != 0xFF)
+				continue;
+			int marker = d[pos + 1];
+			if (marker == 0x00 || marker == 0xFF)
+				continue; // byte de preenchimento
+			if (marker >= 0xD0 && marker <= 0xD7)
+			{
+				layout.intervals.push_back({start, pos});
+				start = pos + 2;
+				pos++;
+				continue;
+			}
+			if (marker == 0xD9)
+			{
+				layout.intervals.push_back({start, pos});
+				break;
+			}
+			return false; // outro marcador no meio da varredura (ex: nova varredura, DNL)
+		}
+
+		int totalMCUs = layout.mcusPerRow * layout.mcuRows;
+		int expected = (totalMCUs + layout.restartInterval - 1) / layout.restartInterval;
+		return (int)layout.intervals.size() == expected;
+	}
+
+	// Monta um JPEG com as linhas de MCU [firstRow, lastRow) a partir dos intervalos
+	inline std::vector<unsigned char> buildStrip(const std::vector<unsigned char> &bytes, const JpegLayout &layout,
+												 int firstInterval, int lastInterval, int stripHeight)
+	{
+		std::vector<unsigned char> strip;
+		strip.reserve(layout.scanStart + (layout.intervals[lastInterval - 1].second - layout.intervals[firstInterval].first) + 64);
+
+		// Cabeçalhos iguais ao original, trocando só a altura no SOF
+		strip.insert(strip.end(), bytes.begin(), bytes.begin() + layout.heightOffset);
+		strip.push_back((unsigned char)(stripHeight >> 8));
+		strip.push_back((unsigned char)(stripHeight & 0xFF));
+		strip.insert(strip.end(), bytes.begin() + layout.heightOffset + 2, bytes.begin() + layout.scanStart);
+
+		// Intervalos, com os RST renumerados a partir de RST0
+		for (int i = firstInterval; i < lastInterval; i++)
+		{
+			const std::pair<size_t, size_t> &range = layout.intervals[i];
+			strip.insert(strip.end(), bytes.begin() + range.first, bytes.begin() + range.second);
+			if (i + 1 < lastInterval)
+			{
+				strip.push_back(0xFF);
+				strip.push_back((unsigned char)(0xD0 + ((i - firstInterval) & 7)));
+			}
+		}
+		strip.push_back(0xFF);
+		strip.push_back(0xD9);
+		return strip;
+	}
+
+#ifdef USE_LIBJPEG_TURBO
+	struct JpegErrorManager
+	{
+		jpeg_error_mgr base;
+		std::jmp_buf jump;
+	};
+
+	inline void jpegErrorExit(j_common_ptr cinfo)
+	{
+		JpegErrorManager *err = (JpegErrorManager *)cinfo->err;
+		std::longjmp(err->jump, 1);
+	}
+
+	// Decodifica um JPEG da memória com libjpeg-turbo direto para dst (RGBA8, linhas de "stride" bytes)
+	inline bool decodeJpegTurbo(const unsigned char *data, size_t size, int &width, int &height,
+								const ImageAllocator &allocate)
+	{
+		jpeg_decompress_struct cinfo;
+		JpegErrorManager jerr;
+		cinfo.err = jpeg_std_error(&jerr.base);
+		jerr.base.error_exit = jpegErrorExit;
+		if (setjmp(jerr.jump))
+		{
+			jpeg_destroy_decompress(&cinfo);
+			return false;
+		}
+
+		jpeg_create_decompress(&cinfo);
+		jpeg_mem_src(&cinfo, data, (unsigned long)size);
+		jpeg_read_header(&cinfo, TRUE);
+		cinfo.out_color_space = JCS_EXT_RGBA;
+		cinfo.dct_method = JDCT_ISLOW; // a versão SIMD da IDCT inteira já é rápida e exata
+		jpeg_start_decompress(&cinfo);
+
+		width = cinfo.output_width;
+		height = cinfo.output_height;
+		unsigned char *dst = allocate(width, height);
+		if (!dst)
+		{
+			jpeg_destroy_decompress(&cinfo);
+			return false;
+		}
+
+		size_t stride = (size_t)width * 4;
+		while (cinfo.output_scanline < cinfo.output_height)
+		{
+			JSAMPROW rows[16];
+			int count = 0;
+			for (; count < 16 && cinfo.output_scanline + count < cinfo.output_height; count++)
+				rows[count] = dst + (cinfo.output_scanline + count) * stride;
+			jpeg_read_scanlines(&cinfo, rows, count);
+		}
+		jpeg_finish_decompress(&cinfo);
+		jpeg_destroy_decompress(&cinfo);
+		return true;
+	}
+#endif
+
+	// O stb_image decodifica num buffer próprio: a imagem é copiada para o destino
+	inline bool decodeWithStb(const unsigned char *data, size_t size, int &width, int &height,
+							  const ImageAllocator &allocate)
+	{
+		int channels;
+		unsigned char *pixels = stbi_load_from_memory(data, (int)size, &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels)
+			return false;
+		unsigned char *dst = allocate(width, height);
+		if (dst)
+			memcpy(dst, pixels, (size_t)width * height * 4);
+		stbi_image_free(pixels);
+		return dst != nullptr;
+	}
+
+	// Decodifica um JPEG inteiro com o backend escolhido
+	inline bool decodeJpeg(const unsigned char *data, size_t size, int &width, int &height, const ImageAllocator &allocate)
+	{
+#ifdef USE_LIBJPEG_TURBO
+		if (imageDecoderBackend == ImageDecoderBackend::LibJpegTurbo)
+			return decodeJpegTurbo(data, size, width, height, allocate);
+#endif
+		return decodeWithStb(data, size, width, height, allocate);
+	}
+
+	// Decodifica em faixas paralelas no pool. Retorna false se o arquivo não permite (sem
+	// reinícios alinhados às linhas de MCU), e então quem chamou decodifica inteiro.
+	// Se alguma faixa falhar, decodifica a imagem inteira no mesmo destino.
+	inline bool decodeJpegParallel(const std::vector<unsigned char> &bytes, int &width, int &height,
+								   const ImageAllocator &allocate, ImageDecoderPool &pool, bool &ok)
+	{
+		ok = false;
+		JpegLayout layout;
+		if (!parseJpegLayout(bytes, layout))
+			return false;
+
+		// Intervalos que começam no início de uma linha de MCU
+		std::vector<int> rowStarts;
+		for (int i = 0; i < (int)layout.intervals.size(); i++)
+			if (((long long)i * layout.restartInterval) % layout.mcusPerRow == 0)
+				rowStarts.push_back(i);
+
+		// Uma faixa por thread do pool, mais uma para quem chamou
+		int numStrips = std::min(pool.threadCount() + 1, (int)rowStarts.size());
+		if (numStrips < 2)
+			return false;
+
+		// Divide os pontos de corte em faixas com quantidades parecidas de linhas
+		std::vector<int> cuts;
+		for (int s = 0; s < numStrips; s++)
+			cuts.push_back(rowStarts[(size_t)s * rowStarts.size() / numStrips]);
+		cuts.push_back((int)layout.intervals.size());
+		cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+
+		width = layout.width;
+		height = layout.height;
+		unsigned char *dst = allocate(width, height);
+		if (!dst)
+			return true;
+
+		std::vector<char> stripOk(cuts.size() - 1, 0);
+		pool.run((int)stripOk.size(), [&](int s) {
+			int firstRow = (int)((long long)cuts[s] * layout.restartInterval / layout.mcusPerRow);
+			int lastRow = std::min(layout.mcuRows, (int)((long long)cuts[s + 1] * layout.restartInterval / layout.mcusPerRow));
+			int y0 = firstRow * layout.mcuHeight;
+			int y1 = std::min(layout.height, lastRow * layout.mcuHeight);
+
+			std::vector<unsigned char> strip = buildStrip(bytes, layout, cuts[s], cuts[s + 1], y1 - y0);
+			unsigned char *rows = dst + (size_t)y0 * layout.width * 4;
+			int w, h;
+			stripOk[s] = decodeJpeg(strip.data(), strip.size(), w, h, [&](int sw, int sh) -> unsigned char * {
+				return (sw == layout.width && sh == y1 - y0) ? rows : nullptr;
+			});
+		});
+
+		ok = std::find(stripOk.begin(), stripOk.end(), 0) == stripOk.end();
+		if (!ok)
+		{
+			// O destino já foi alocado: a decodificação inteira escreve nele mesmo
+			int w, h;
+			ok = decodeJpeg(bytes.data(), bytes.size(), w, h, [&](int sw, int sh) -> unsigned char * {
+				return (sw == width && sh == height) ? dst : nullptr;
+			});
+		}
+		return true;
+	}
+}
+
+// Lê só as dimensões da imagem
+inline bool imageInfo(const std::string &path, int &width, int &height)
+{
+	int channels;
+	return stbi_info(path.c_str(), &width, &height, &channels) != 0;
+}
+
+// Decodifica a imagem em RGBA8 no destino devolvido por "allocate". Com um pool e
+// imageDecoderParallelRestart ligado, JPEGs com reinícios são decodificados em faixas.
+inline bool decodeImageRGBA(const std::string &path, int &width, int &height, const ImageAllocator &allocate,
+							ImageDecoderPool *pool = nullptr)
+{
+	std::vector<unsigned char> bytes;
+	if (!imagedecoder::readFile(path, bytes))
+		return false;
+
+	if (!imagedecoder::isJPEG(bytes))
+		return imagedecoder::decodeWithStb(bytes.data(), bytes.size(), width, height, allocate);
+
+	if (imageDecoderParallelRestart && pool)
+	{
+		bool ok;
+		if (imagedecoder::decodeJpegParallel(bytes, width, height, allocate, *pool, ok))
+			return ok;
+	}
+	return imagedecoder::decodeJpeg(bytes.data(), bytes.size(), width, height, allocate);
+}
+
+// Versão que devolve os pixels num vetor
+inline bool decodeImageRGBA(const std::string &path, int &width, int &height, std::vector<unsigned char> &pixels)
+{
+	return decodeImageRGBA(path, width, height, [&](int w, int h) {
+		pixels.resize((size_t)w * h * 4);
+		return pixels.data();
+	});
+}
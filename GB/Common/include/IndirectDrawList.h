@@ -0,0 +1,264 @@
+// Lista de desenhos enviada com glMultiDrawElementsIndirect
+//
+// A cada quadro a cena adiciona os objetos visíveis (malha do GeometryPool, matriz de
+// modelo, material e textura). submit() monta um DrawElementsIndirectCommand por objeto
+// e, num buffer de atributos por instância (formato InstanceStream, o mesmo do
+// InstanceBatch), a matriz e o material de cada um. Cada comando desenha 1 instância
+// com baseInstance = posição do objeto nesse buffer, então a variação INSTANCING do
+// phong lê a matriz e o material certos sem uniform nenhum (não precisa de gl_DrawID).
+//
+// Todos os objetos com a mesma textura saem num único glMultiDrawElementsIndirect;
+// o número de chamadas depende de quantas texturas há, não de quantos objetos.
+// Só malhas com índices podem ir na lista.
+//
+// Com um FrameRing, matrizes, materiais e comandos são copiados para a região do
+// quadro no anel persistente e o baseInstance já inclui o deslocamento da faixa no
+// anel. Sem ele (ou com o anel cheio) os buffers próprios da lista são reenviados.
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+//GLAD
+#include <glad/glad.h>
+
+//GLM
+#include <glm/glm.hpp>
+
+#include "GLExtensoes.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+#include "GeometryPool.h"
+#include "InstanceBatch.h"
+#include "FrameRing.h"
+
+// Layout fixado pela OpenGL para os comandos de glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "DrawElementsIndirectCommand com preenchimento");
+
+template <typename Layout>
+class IndirectDrawList
+{
+public:
+	using Pool = GeometryPool<Layout>;
+
+	// Precisa de glMultiDrawElementsIndirect (4.3) e de base instance (4.2)
+	static bool supported() { return glx::MultiDrawElementsIndirect != nullptr; }
+
+	void create(Pool &pool, GpuMemoryRegistry *registry = nullptr, const std::string &name = "indirect draws",
+				FrameRing *ring = nullptr)
+	{
+		this->pool = &pool;
+		this->registry = registry;
+		this->ring = ring;
+
+		glGenVertexArrays(1, &vertexArray);
+		glGenBuffers(1, &instanceBuffer);
+		glGenBuffers(1, &commandBuffer);
+		pool.attach(vertexArray);
+
+		// Uma cópia identidade, para o VAO já poder ser desenhado antes do primeiro submit()
+		InstanceData identity;
+		instanceCapacity = sizeof(InstanceData);
+		glState.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, instanceCapacity, &identity, GL_STREAM_DRAW);
+		useInstanceSource(instanceBuffer);
+
+		if (registry)
+		{
+			registry->trackBuffer(instanceBuffer, GL_ARRAY_BUFFER, instanceCapacity, GpuSubsystem::Geometry,
+								  name + " instances", vertexArray);
+			registry->trackBuffer(commandBuffer, GL_DRAW_INDIRECT_BUFFER, 0, GpuSubsystem::Geometry, name + " commands", vertexArray);
+		}
+	}
+
+	void add(typename Pool::Handle mesh, const glm::mat4 &model, GLuint material, GLuint texture = 0)
+	{
+		draws.push_back({mesh, texture, {model, material}});
+	}
+
+	void clear() { draws.clear(); }
+	size_t size() const { return draws.size(); }
+
+	// Envia os comandos do quadro e desenha. O programa (variação INSTANCING) já deve estar ativo
+	// e a unidade de textura desejada ativa. Retorna quantas chamadas de desenho foram feitas.
+	int submit(GLenum mode = GL_TRIANGLES)
+	{
+		if (draws.empty())
+			return 0;
+
+		// Agrupa por textura mantendo a ordem de chegada dentro do grupo
+		std::stable_sort(draws.begin(), draws.end(), [](const Draw &a, const Draw &b) { return a.texture < b.texture; });
+
+		commands.clear();
+		instances.clear();
+		textures.clear();
+		for (const Draw &draw : draws)
+		{
+			MeshRange range = pool->range(draw.mesh);
+			if (!range.indexCount)
+			{
+				std::cout << "ERROR::INDIRECT::MESH_WITHOUT_INDICES" << std::endl;
+				continue;
+			}
+			DrawElementsIndirectCommand command;
+			command.count = (GLuint)range.indexCount;
+			command.instanceCount = 1;
+			command.firstIndex = range.firstIndex;
+			command.baseVertex = range.firstVertex;
+			command.baseInstance = (GLuint)instances.size();
+			commands.push_back(command);
+			instances.push_back(draw.instance);
+			textures.push_back(draw.texture);
+		}
+		if (commands.empty())
+			return 0;
+
+		size_t instanceBytes = instances.size() * sizeof(InstanceData);
+		size_t commandBytes = commands.size() * sizeof(DrawElementsIndirectCommand);
+		FrameAllocation instanceSlice, commandSlice;
+		if (ring)
+		{
+			// Alinhada no tamanho de uma instância: a faixa começa na instância offset / stride
+			instanceSlice = ring->allocate(instanceBytes, sizeof(InstanceData));
+			commandSlice = ring->allocate(commandBytes, sizeof(GLuint));
+		}
+
+		GLuint commandSource;
+		size_t commandOffset;
+		if (instanceSlice.valid() && commandSlice.valid())
+		{
+			GLuint firstInstance = (GLuint)(instanceSlice.offset / sizeof(InstanceData));
+			for (DrawElementsIndirectCommand &command : commands)
+				command.baseInstance += firstInstance;
+			memcpy(instanceSlice.ptr, instances.data(), instanceBytes);
+			memcpy(commandSlice.ptr, commands.data(), commandBytes);
+			ring->flush();
+			useInstanceSource(ring->buffer());
+			commandSource = ring->buffer();
+			commandOffset = commandSlice.offset;
+		}
+		else
+		{
+			upload(GL_ARRAY_BUFFER, instanceBuffer, instanceCapacity, instances.data(), instanceBytes);
+			upload(GL_DRAW_INDIRECT_BUFFER, commandBuffer, commandCapacity, commands.data(), commandBytes);
+			useInstanceSource(instanceBuffer);
+			commandSource = commandBuffer;
+			commandOffset = 0;
+		}
+
+		glState.bindVertexArray(vertexArray);
+		glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandSource);
+		int calls = 0;
+		for (size_t first = 0; first < commands.size();)
+		{
+			size_t last = first;
+			while (last < commands.size() && textures[last] == textures[first])
+				last++;
+			glState.bindTexture(GL_TEXTURE_2D, textures[first]);
+			glx::MultiDrawElementsIndirect(mode, GL_UNSIGNED_INT,
+										   (const GLvoid *)(commandOffset + first * sizeof(DrawElementsIndirectCommand)),
+										   (GLsizei)(last - first), 0);
+			calls++;
+			first = last;
+		}
+		return calls;
+	}
+
+	GLuint vao() const { return vertexArray; }
+
+	void destroy()
+	{
+		if (pool && vertexArray)
+			pool->detach(vertexArray);
+		if (registry && vertexArray)
+		{
+			registry->releaseVertexArray(vertexArray);
+		}
+		else
+		{
+			GLuint buffers[2] = {instanceBuffer, commandBuffer};
+			for (GLuint id : buffers)
+			{
+				if (!id)
+					continue;
+				glState.forgetBuffer(id);
+				glDeleteBuffers(1, &id);
+			}
+			if (vertexArray)
+			{
+				glState.forgetVertexArray(vertexArray);
+				glDeleteVertexArrays(1, &vertexArray);
+			}
+		}
+		vertexArray = instanceBuffer = commandBuffer = 0;
+		instanceCapacity = commandCapacity = 0;
+		draws.clear();
+	}
+
+private:
+	struct Draw
+	{
+		typename Pool::Handle mesh;
+		GLuint texture;
+		InstanceData instance;
+	};
+
+	Pool *pool = nullptr;
+	std::vector<Draw> draws;
+	std::vector<DrawElementsIndirectCommand> commands;
+	std::vector<InstanceData> instances;
+	std::vector<GLuint> textures;
+	GLuint vertexArray = 0, instanceBuffer = 0, commandBuffer = 0;
+	size_t instanceCapacity = 0, commandCapacity = 0;
+	GpuMemoryRegistry *registry = nullptr;
+	FrameRing *ring = nullptr;
+	GLuint instanceSource = 0; // buffer de onde o VAO lê as instâncias
+	unsigned ringGeneration = 0;
+
+	// Aponta os atributos por instância para o buffer (só quando ele muda)
+	void useInstanceSource(GLuint buffer)
+	{
+		unsigned generation = ring ? ring->generation() : 0;
+		if (buffer == instanceSource && generation == ringGeneration)
+			return;
+		instanceSource = buffer;
+		ringGeneration = generation;
+		glState.bindVertexArray(vertexArray);
+		glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+		InstanceStream::setup(0, 1);
+		glState.bindVertexArray(0);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Os dados mudam todo quadro: o armazenamento antigo é descartado (orphaning) para
+	// não esperar a GPU terminar de ler o quadro anterior
+	void upload(GLenum target, GLuint buffer, size_t &capacity, const void *data, size_t bytes)
+	{
+		glState.bindBuffer(target, buffer);
+		if (bytes > capacity)
+		{
+			capacity = std::max<size_t>(capacity * 2, 1024);
+			while (capacity < bytes)
+				capacity *= 2;
+			if (registry)
+				registry->resize(GpuResourceType::Buffer, buffer, capacity);
+		}
+		glBufferData(target, capacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(target, 0, bytes, data);
+		if (target != GL_DRAW_INDIRECT_BUFFER)
+			glState.bindBuffer(target, 0);
+	}
+};
@@ -0,0 +1,310 @@
+// Muitas cópias de uma malha num único desenho instanciado
+//
+// Um InstanceBatch guarda, para uma malha do GeometryPool, a matriz de modelo e o
+// índice do material de cada cópia num buffer de atributos por instância (divisor 1).
+// O batch tem um VAO próprio, ligado aos buffers do pool (GeometryPool::attach()) e ao
+// buffer de instâncias: a matriz ocupa as localizações 6 a 9 (instanceModel, variação
+// INSTANCING do phong) e o material a localização 4 (materialIndex, MaterialRegistry.h).
+// Desenhar N cópias é um único glDrawElementsInstancedBaseVertex, sem glUniform* por
+// cópia. Só a faixa alterada das instâncias é reenviada em upload().
+//
+// Com um FrameRing (e base instance, GL 4.2), as cópias de cada quadro são escritas na
+// região do quadro no anel, alinhadas no stride de InstanceData, e o desenho começa na
+// instância offset / stride (firstInstance()). Sem ele, com o anel cheio ou sem base
+// instance, vale o buffer próprio com a faixa suja. Outro VAO que leia as mesmas cópias
+// (DepthPrepass::instanced()) usa source(), firstInstance() e sourceGeneration().
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstring>
+
+//GLAD
+#include <glad/glad.h>
+
+//GLM
+#include <glm/glm.hpp>
+
+#include "GLExtensoes.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+#include "VertexLayout.h"
+#include "MaterialRegistry.h"
+#include "GeometryPool.h"
+#include "FrameRing.h"
+
+// Dados de uma cópia, na ordem do buffer de instâncias
+struct InstanceData
+{
+	glm::mat4 model = glm::mat4(1.0f);
+	GLuint material = 0;
+};
+
+// Colunas da matriz de modelo: um mat4 no shader ocupa 4 localizações seguidas
+template <int Column>
+struct InstanceModelColumn : VertexAttr<6 + Column, GLfloat, 4>
+{
+	static constexpr const char *name = "instanceModel";
+};
+using InstanceStream = VertexLayout<InstanceModelColumn<0>, InstanceModelColumn<1>, InstanceModelColumn<2>,
+									InstanceModelColumn<3>, MaterialIndex>;
+
+static_assert(InstanceStream::stride == sizeof(InstanceData), "InstanceData fora do formato InstanceStream");
+
+template <typename Layout>
+class InstanceBatch
+{
+public:
+	using Pool = GeometryPool<Layout>;
+
+	// Desenho a partir de uma instância qualquer (necessário para ler do FrameRing)
+	static bool baseInstanceSupported()
+	{
+		return glx::DrawElementsInstancedBaseVertexBaseInstance != nullptr && glx::DrawArraysInstancedBaseInstance != nullptr;
+	}
+
+	void create(Pool &pool, typename Pool::Handle mesh, GpuMemoryRegistry *registry = nullptr,
+				const std::string &name = "instances", FrameRing *ring = nullptr)
+	{
+		this->pool = &pool;
+		this->mesh = mesh;
+		this->registry = registry;
+		this->ring = baseInstanceSupported() ? ring : nullptr;
+
+		glGenVertexArrays(1, &vertexArray);
+		glGenBuffers(1, &instanceBuffer);
+		pool.attach(vertexArray);
+
+		// Uma cópia identidade, para o VAO já poder ser desenhado (ex: no aquecimento dos
+		// pipelines) antes do primeiro upload()
+		InstanceData identity;
+		capacity = 1;
+		glState.bindVertexArray(vertexArray);
+		glState.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData), &identity, GL_DYNAMIC_DRAW);
+		InstanceStream::setup(0, 1);
+		glState.bindVertexArray(0);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+		instanceSource = instanceBuffer;
+		firstCopy = 0;
+
+		if (registry)
+			registry->trackBuffer(instanceBuffer, GL_ARRAY_BUFFER, sizeof(InstanceData), GpuSubsystem::Geometry, name,
+								  vertexArray);
+	}
+
+	// Adiciona uma cópia e retorna o índice dela
+	size_t add(const glm::mat4 &model, GLuint material)
+	{
+		instances.push_back({model, material});
+		markDirty(instances.size() - 1);
+		return instances.size() - 1;
+	}
+
+	void set(size_t index, const glm::mat4 &model, GLuint material)
+	{
+		if (index >= instances.size())
+			return;
+		instances[index] = {model, material};
+		markDirty(index);
+	}
+
+	void setModel(size_t index, const glm::mat4 &model)
+	{
+		if (index >= instances.size())
+			return;
+		instances[index].model = model;
+		markDirty(index);
+	}
+
+	// Troca todas as cópias de uma vez (ex: as que passaram no teste de visibilidade do quadro)
+	void assign(const std::vector<InstanceData> &data)
+	{
+		instances.assign(data.begin(), data.end());
+		dirtyBegin = 0;
+		dirtyEnd = instances.size();
+	}
+
+	const InstanceData &get(size_t index) const { return instances[index]; }
+	size_t size() const { return instances.size(); }
+
+	void clear()
+	{
+		instances.clear();
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	void reserve(size_t count) { instances.reserve(count); }
+
+	// Com o anel: copia todas as cópias para a região do quadro (uma vez por quadro, ou de
+	// novo se algo mudou). Sem ele: envia só a faixa suja ao buffer próprio.
+	void upload()
+	{
+		if (ring && !instances.empty())
+		{
+			if (ringFrame == ring->frame() && dirtyBegin >= dirtyEnd && instanceSource == ring->buffer())
+				return;
+			size_t bytes = instances.size() * sizeof(InstanceData);
+			// Alinhada no tamanho de uma instância: a faixa começa na instância offset / stride
+			FrameAllocation slice = ring->allocate(bytes, sizeof(InstanceData));
+			if (slice.valid())
+			{
+				memcpy(slice.ptr, instances.data(), bytes);
+				ring->flush();
+				useInstanceSource(ring->buffer());
+				firstCopy = (GLuint)(slice.offset / sizeof(InstanceData));
+				ringFrame = ring->frame();
+				// O buffer próprio ficou para trás: se o anel faltar, ele é reenviado inteiro
+				bufferStale = true;
+				dirtyBegin = dirtyEnd = 0;
+				return;
+			}
+		}
+		if (bufferStale)
+		{
+			dirtyBegin = 0;
+			dirtyEnd = instances.size();
+			bufferStale = false;
+		}
+		uploadBuffer();
+		useInstanceSource(instanceBuffer);
+		firstCopy = 0;
+	}
+
+	// Desenha todas as cópias (o programa já ativo precisa ser uma variação INSTANCING).
+	// Malhas sem índices caem no glDrawArraysInstanced.
+	void draw(GLenum mode = GL_TRIANGLES)
+	{
+		upload();
+		if (instances.empty())
+			return;
+		MeshRange range = pool->range(mesh);
+		glState.bindVertexArray(vertexArray);
+		if (firstCopy && range.indexCount)
+			glx::DrawElementsInstancedBaseVertexBaseInstance(mode, range.indexCount, GL_UNSIGNED_INT,
+															 (GLvoid *)(range.firstIndex * sizeof(GLuint)),
+															 (GLsizei)instances.size(), range.firstVertex, firstCopy);
+		else if (firstCopy)
+			glx::DrawArraysInstancedBaseInstance(mode, range.firstVertex, range.vertexCount, (GLsizei)instances.size(),
+												 firstCopy);
+		else if (range.indexCount)
+			glDrawElementsInstancedBaseVertex(mode, range.indexCount, GL_UNSIGNED_INT,
+											  (GLvoid *)(range.firstIndex * sizeof(GLuint)), (GLsizei)instances.size(),
+											  range.firstVertex);
+		else
+			glDrawArraysInstanced(mode, range.firstVertex, range.vertexCount, (GLsizei)instances.size());
+	}
+
+	GLuint vao() const { return vertexArray; }
+	// Buffer próprio das instâncias (o caminho sem anel)
+	GLuint buffer() const { return instanceBuffer; }
+	// De onde o último upload() deixou as cópias: o buffer (próprio ou do anel), a primeira
+	// instância nele e a geração do anel (o buffer do anel pode ser recriado com o mesmo nome)
+	GLuint source() const { return instanceSource; }
+	GLuint firstInstance() const { return firstCopy; }
+	unsigned sourceGeneration() const { return ring && instanceSource != instanceBuffer ? ring->generation() : 0; }
+
+	void destroy()
+	{
+		if (pool && vertexArray)
+			pool->detach(vertexArray);
+		if (registry && vertexArray)
+		{
+			registry->releaseVertexArray(vertexArray);
+		}
+		else
+		{
+			if (instanceBuffer)
+			{
+				glState.forgetBuffer(instanceBuffer);
+				glDeleteBuffers(1, &instanceBuffer);
+			}
+			if (vertexArray)
+			{
+				glState.forgetVertexArray(vertexArray);
+				glDeleteVertexArrays(1, &vertexArray);
+			}
+		}
+		vertexArray = instanceBuffer = instanceSource = 0;
+		capacity = 0;
+		firstCopy = 0;
+		bufferStale = false;
+		instances.clear();
+	}
+
+private:
+	Pool *pool = nullptr;
+	typename Pool::Handle mesh = Pool::INVALID_HANDLE;
+	std::vector<InstanceData> instances;
+	GLuint vertexArray = 0, instanceBuffer = 0;
+	size_t capacity = 0;
+	size_t dirtyBegin = 0, dirtyEnd = 0;
+	GpuMemoryRegistry *registry = nullptr;
+	FrameRing *ring = nullptr;
+	GLuint instanceSource = 0; // buffer de onde o VAO lê as instâncias
+	GLuint firstCopy = 0;	   // baseInstance dos desenhos
+	unsigned ringGeneration = 0;
+	unsigned long ringFrame = 0;
+	bool bufferStale = false;
+
+	// Aponta os atributos por instância para o buffer (só quando ele ou o anel mudam)
+	void useInstanceSource(GLuint buffer)
+	{
+		unsigned generation = ring ? ring->generation() : 0;
+		if (buffer == instanceSource && generation == ringGeneration)
+			return;
+		instanceSource = buffer;
+		ringGeneration = generation;
+		glState.bindVertexArray(vertexArray);
+		glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+		InstanceStream::setup(0, 1);
+		glState.bindVertexArray(0);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Envia as instâncias alteradas (só a faixa suja); o buffer cresce em potências de 2
+	void uploadBuffer()
+	{
+		if (dirtyBegin >= dirtyEnd)
+			return;
+		glState.bindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+		if (instances.size() > capacity)
+		{
+			capacity = std::max<size_t>(capacity * 2, 64);
+			while (capacity < instances.size())
+				capacity *= 2;
+			glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+			if (registry)
+				registry->resize(GpuResourceType::Buffer, instanceBuffer, capacity * sizeof(InstanceData));
+		}
+		else if (dirtyBegin == 0 && dirtyEnd == instances.size())
+		{
+			// Tudo mudou: descarta o armazenamento antigo (orphaning) para não esperar a GPU
+			// terminar o desenho anterior
+			glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_DYNAMIC_DRAW);
+			glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+		}
+		else
+		{
+			glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin * sizeof(InstanceData), (dirtyEnd - dirtyBegin) * sizeof(InstanceData),
+							instances.data() + dirtyBegin);
+		}
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+		dirtyBegin = dirtyEnd = 0;
+	}
+
+	void markDirty(size_t index)
+	{
+		if (dirtyBegin == dirtyEnd)
+		{
+			dirtyBegin = index;
+			dirtyEnd = index + 1;
+			return;
+		}
+		dirtyBegin = std::min(dirtyBegin, index);
+		dirtyEnd = std::max(dirtyEnd, index + 1);
+	}
+};
@@ -0,0 +1,491 @@
+// Sistema de tarefas com roubo de trabalho (work stealing)
+//
+// Cada thread (as de trabalho e a principal, que é a thread 0) tem uma fila dupla de
+// Chase-Lev: a dona empilha e desempilha as próprias tarefas pelo fundo (LIFO, dados
+// ainda no cache) sem trava, e as threads ociosas roubam pelo topo (FIFO). Tarefas
+// criadas por threads de fora do sistema, ou quando a fila da thread enche, vão para
+// uma fila global com trava.
+//
+// Dependências são contadores: spawn() incrementa o contador da tarefa e a conclusão
+// decrementa. wait() não bloqueia a thread: enquanto o contador não zera, ela executa
+// outras tarefas. then() registra uma continuação, agendada quando o contador zerar.
+//
+// Tarefas que chamam a OpenGL só podem rodar na thread do contexto: spawnMain() as
+// coloca numa fila que só a thread principal executa (em runMainThreadJobs() ou
+// enquanto espera num wait()).
+//
+// As tarefas guardam a função (lambda) dentro de si quando ela cabe em 64 bytes e vêm
+// de um anel pré-alocado por thread, então criar uma tarefa não aloca memória.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+class JobSystem;
+struct Job;
+
+// Contador de tarefas pendentes
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter &) = delete;
+	JobCounter &operator=(const JobCounter &) = delete;
+
+	int pending() const { return count.load(std::memory_order_acquire); }
+	bool done() const { return pending() == 0; }
+
+private:
+	friend class JobSystem;
+	std::atomic<int> count{0};
+	std::mutex mutex;
+	std::vector<Job *> continuations; // agendadas quando count chegar a zero
+};
+
+struct Job
+{
+	void (*run)(Job &) = nullptr;
+	void (*destroy)(Job &) = nullptr;
+	JobCounter *counter = nullptr;
+	bool mainThread = false; // só roda na thread principal
+	bool heap = false;		 // criada com new (anel da thread cheio ou thread de fora)
+	std::atomic<bool> inUse{false};
+	alignas(std::max_align_t) unsigned char payload[64];
+};
+
+// Fila dupla de Chase-Lev com capacidade fixa (Lê et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models", com as barreiras trocadas por operações
+// seq_cst equivalentes). push()/pop() só pela thread dona.
+class WorkStealingDeque
+{
+public:
+	static const int64_t CAPACITY = 4096;
+
+	bool push(Job *job)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t >= CAPACITY)
+			return false;
+		buffer[b & MASK].store(job, std::memory_order_relaxed);
+		bottom.store(b + 1, std::memory_order_release); // publica a tarefa para quem rouba
+		return true;
+	}
+
+	Job *pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		// seq_cst: a reserva do fundo precisa ser vista antes da leitura do topo
+		bottom.store(b, std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_seq_cst);
+		if (t > b)
+		{
+			// Vazia
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		Job *job = buffer[b & MASK].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			// Último elemento: disputa com quem estiver roubando
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job *steal()
+	{
+		int64_t t = top.load(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_seq_cst);
+		if (t >= b)
+			return nullptr;
+		Job *job = buffer[t & MASK].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr; // outra thread levou
+		return job;
+	}
+
+private:
+	static const int64_t MASK = CAPACITY - 1;
+	static_assert((CAPACITY & MASK) == 0, "capacidade deve ser potência de 2");
+
+	alignas(64) std::atomic<int64_t> top{0};
+	alignas(64) std::atomic<int64_t> bottom{0};
+	std::atomic<Job *> buffer[CAPACITY];
+};
+
+// Índice da thread atual no sistema (-1 fora dele)
+inline thread_local int jobThreadIndex = -1;
+inline thread_local const JobSystem *jobThreadOwner = nullptr;
+
+class JobSystem
+{
+public:
+	static const size_t JOBS_PER_THREAD = 4096;
+
+	// Deve ser criado na thread principal. numWorkers <= 0: um por núcleo, menos a principal.
+	explicit JobSystem(int numWorkers = 0)
+	{
+		if (numWorkers <= 0)
+			numWorkers = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+		threads.resize(numWorkers + 1);
+		for (auto &t : threads)
+			t.reset(new ThreadData());
+		registerThread(0);
+		for (int i = 1; i <= numWorkers; i++)
+			workers.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+
+	~JobSystem()
+	{
+		shutdown();
+	}
+
+	// Termina as tarefas que restam e encerra as threads de trabalho
+	void shutdown()
+	{
+		if (stopping.exchange(true))
+			return;
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		sleepCond.notify_all();
+		for (std::thread &t : workers)
+			t.join();
+		workers.clear();
+		// O que sobrou na fila da principal roda aqui
+		while (Job *job = findJob(0))
+			execute(job);
+	}
+
+	int workerCount() const { return (int)workers.size(); }
+	int threadCount() const { return (int)threads.size(); }
+	// Índice da thread atual (0 = principal, -1 = fora do sistema)
+	int currentThread() const { return jobThreadOwner == this ? jobThreadIndex : -1; }
+	bool isMainThread() const { return currentThread() == 0; }
+
+	// Agenda f() em qualquer thread
+	template <typename F>
+	void spawn(F &&f, JobCounter *counter = nullptr)
+	{
+		Job *job = create(std::forward<F>(f), counter, false);
+		if (counter)
+			counter->count.fetch_add(1, std::memory_order_relaxed);
+		schedule(job);
+	}
+
+	// Agenda f() na thread principal (chamadas GL)
+	template <typename F>
+	void spawnMain(F &&f, JobCounter *counter = nullptr)
+	{
+		Job *job = create(std::forward<F>(f), counter, true);
+		if (counter)
+			counter->count.fetch_add(1, std::memory_order_relaxed);
+		schedule(job);
+	}
+
+	// Continuação: f() é agendada quando "after" zerar (ou já, se estiver zerado).
+	// next (opcional) conta a continuação desde já, então wait(*next) espera por ela.
+	template <typename F>
+	void then(JobCounter &after, F &&f, JobCounter *next = nullptr, bool mainThread = false)
+	{
+		Job *job = create(std::forward<F>(f), next, mainThread);
+		if (next)
+			next->count.fetch_add(1, std::memory_order_relaxed);
+		{
+			std::lock_guard<std::mutex> lock(after.mutex);
+			if (after.count.load(std::memory_order_acquire) > 0)
+			{
+				after.continuations.push_back(job);
+				return;
+			}
+		}
+		schedule(job);
+	}
+
+	// Executa outras tarefas até o contador zerar
+	void wait(JobCounter &counter)
+	{
+		int index = currentThread();
+		int idle = 0;
+		while (counter.count.load(std::memory_order_acquire) > 0)
+		{
+			Job *job = index >= 0 ? findJob(index) : popGlobal();
+			if (job)
+			{
+				execute(job);
+				idle = 0;
+			}
+			else if (++idle > 64)
+			{
+				std::this_thread::yield();
+			}
+		}
+		std::lock_guard<std::mutex> lock(counter.mutex);
+	}
+
+	// Divide [begin, end) em blocos de até grain elementos e chama f(first, last) em
+	// paralelo; retorna quando todos terminarem (a thread que chama também trabalha)
+	template <typename F>
+	void parallelFor(size_t begin, size_t end, size_t grain, F &&f)
+	{
+		if (begin >= end)
+			return;
+		grain = std::max<size_t>(grain, 1);
+		JobCounter counter;
+		size_t first = begin;
+		for (; first + grain < end; first += grain)
+		{
+			size_t last = first + grain;
+			spawn([&f, first, last] { f(first, last); }, &counter);
+		}
+		f(first, end); // o último bloco roda aqui mesmo
+		wait(counter);
+	}
+
+	// Executa as tarefas da thread principal que estão na fila (chamar uma vez por quadro)
+	int runMainThreadJobs()
+	{
+		if (!isMainThread())
+			return 0;
+		int count = 0;
+		while (Job *job = popMain())
+		{
+			execute(job);
+			count++;
+		}
+		return count;
+	}
+
+private:
+	struct ThreadData
+	{
+		WorkStealingDeque deque;
+		std::unique_ptr<Job[]> pool{new Job[JOBS_PER_THREAD]};
+		size_t next = 0;
+		unsigned random = 1;
+	};
+
+	std::vector<std::unique_ptr<ThreadData>> threads;
+	std::vector<std::thread> workers;
+	std::atomic<bool> stopping{false};
+
+	std::mutex globalMutex, mainMutex;
+	std::deque<Job *> globalJobs, mainJobs;
+	std::atomic<int> globalCount{0}, mainCount{0};
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCond;
+	std::atomic<int> sleeping{0};
+
+	void registerThread(int index)
+	{
+		jobThreadIndex = index;
+		jobThreadOwner = this;
+		threads[index]->random = 2654435761u * (index + 1);
+	}
+
+	template <typename F>
+	Job *create(F &&f, JobCounter *counter, bool mainThread)
+	{
+		Job *job = nullptr;
+		int index = currentThread();
+		if (index >= 0)
+		{
+			ThreadData &data = *threads[index];
+			Job &slot = data.pool[data.next % JOBS_PER_THREAD];
+			if (!slot.inUse.load(std::memory_order_acquire))
+			{
+				data.next++;
+				job = &slot;
+				job->heap = false;
+			}
+		}
+		if (!job)
+		{
+			job = new Job();
+			job->heap = true;
+		}
+		job->inUse.store(true, std::memory_order_relaxed);
+		job->counter = counter;
+		job->mainThread = mainThread;
+		bind(*job, std::forward<F>(f));
+		return job;
+	}
+
+	template <typename F>
+	static void bind(Job &job, F &&f)
+	{
+		using Fn = typename std::decay<F>::type;
+		if constexpr (sizeof(Fn) <= sizeof(job.payload) && alignof(Fn) <= alignof(std::max_align_t))
+		{
+			new (job.payload) Fn(std::forward<F>(f));
+			job.run = [](Job &j) { (*std::launder(reinterpret_cast<Fn *>(j.payload)))(); };
+			job.destroy = [](Job &j) { std::launder(reinterpret_cast<Fn *>(j.payload))->~Fn(); };
+		}
+		else
+		{
+			// Lambda grande: fica no heap e a tarefa guarda só o ponteiro
+			Fn *fn = new Fn(std::forward<F>(f));
+			memcpy(job.payload, &fn, sizeof(fn));
+			job.run = [](Job &j) {
+				Fn *p;
+				memcpy(&p, j.payload, sizeof(p));
+				(*p)();
+			};
+			job.destroy = [](Job &j) {
+				Fn *p;
+				memcpy(&p, j.payload, sizeof(p));
+				delete p;
+			};
+		}
+	}
+
+	void schedule(Job *job)
+	{
+		if (job->mainThread)
+		{
+			std::lock_guard<std::mutex> lock(mainMutex);
+			mainJobs.push_back(job);
+			mainCount.fetch_add(1, std::memory_order_release);
+			return; // a principal não dorme: pega a tarefa no próximo runMainThreadJobs()/wait()
+		}
+		int index = currentThread();
+		if (index < 0 || !threads[index]->deque.push(job))
+		{
+			std::lock_guard<std::mutex> lock(globalMutex);
+			globalJobs.push_back(job);
+			globalCount.fetch_add(1, std::memory_order_release);
+		}
+		if (sleeping.load(std::memory_order_acquire) > 0)
+			sleepCond.notify_one();
+	}
+
+	Job *popMain()
+	{
+		if (mainCount.load(std::memory_order_acquire) == 0)
+			return nullptr;
+		std::lock_guard<std::mutex> lock(mainMutex);
+		if (mainJobs.empty())
+			return nullptr;
+		Job *job = mainJobs.front();
+		mainJobs.pop_front();
+		mainCount.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	Job *popGlobal()
+	{
+		if (globalCount.load(std::memory_order_acquire) == 0)
+			return nullptr;
+		std::lock_guard<std::mutex> lock(globalMutex);
+		if (globalJobs.empty())
+			return nullptr;
+		Job *job = globalJobs.front();
+		globalJobs.pop_front();
+		globalCount.fetch_sub(1, std::memory_order_relaxed);
+		return job;
+	}
+
+	// Própria fila, tarefas da principal, fila global e, por fim, roubo de outra thread
+	Job *findJob(int index)
+	{
+		ThreadData &data = *threads[index];
+		if (Job *job = data.deque.pop())
+			return job;
+		if (index == 0)
+			if (Job *job = popMain())
+				return job;
+		if (Job *job = popGlobal())
+			return job;
+		int count = (int)threads.size();
+		if (count > 1)
+		{
+			data.random = data.random * 1664525u + 1013904223u;
+			int start = (int)(data.random >> 8) % count;
+			for (int i = 0; i < count; i++)
+			{
+				int victim = (start + i) % count;
+				if (victim == index)
+					continue;
+				if (Job *job = threads[victim]->deque.steal())
+					return job;
+			}
+		}
+		return nullptr;
+	}
+
+	void execute(Job *job)
+	{
+		job->run(*job);
+		job->destroy(*job);
+		JobCounter *counter = job->counter;
+		if (job->heap)
+			delete job;
+		else
+			job->inUse.store(false, std::memory_order_release);
+		if (counter)
+			finish(*counter);
+	}
+
+	// Decrementa o contador. A última conclusão é feita com a trava do contador, que
+	// wait() também pega antes de retornar: assim quem espera só destrói o contador
+	// depois que ninguém mais mexe nele.
+	void finish(JobCounter &counter)
+	{
+		int count = counter.count.load(std::memory_order_acquire);
+		while (count > 1)
+			if (counter.count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_acquire))
+				return;
+		std::vector<Job *> ready;
+		{
+			std::lock_guard<std::mutex> lock(counter.mutex);
+			if (counter.count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				ready.swap(counter.continuations); // zerou: libera as continuações
+		}
+		for (Job *next : ready)
+			schedule(next);
+	}
+
+	void workerLoop(int index)
+	{
+		registerThread(index);
+		int idle = 0;
+		while (!stopping.load(std::memory_order_acquire))
+		{
+			if (Job *job = findJob(index))
+			{
+				execute(job);
+				idle = 0;
+				continue;
+			}
+			// Gira um pouco antes de dormir: tarefas costumam chegar em rajadas
+			if (++idle < 256)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			sleeping.fetch_add(1, std::memory_order_acq_rel);
+			sleepCond.wait_for(lock, std::chrono::milliseconds(2));
+			sleeping.fetch_sub(1, std::memory_order_acq_rel);
+			idle = 0;
+		}
+	}
+};
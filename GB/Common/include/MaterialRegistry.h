@@ -0,0 +1,206 @@
+// Registro de materiais num shader storage buffer (std430) indexado por desenho
+//
+// Todos os materiais da cena ficam num único array na GPU. Cada desenho informa só
+// o índice do material, sem glUniform*: o VAO lê o atributo materialIndex
+// (localização 4, um por instância) de um buffer com os números 0, 1, 2, ..., e o
+// desenho usa o índice do material como instância base (glDrawArraysInstancedBaseInstance).
+// Assim objetos com materiais diferentes podem ser desenhados em sequência sem trocar
+// estado. Sem ARB_base_instance o índice é passado como valor constante do atributo
+// (glVertexAttribI4ui), que também não é um uniform.
+
+#pragma once
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLExtensoes.h"
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+#include "VertexLayout.h"
+
+// Ponto de ligação do array de materiais (GL_SHADER_STORAGE_BUFFER)
+const GLuint MATERIAL_STORAGE_BINDING = 0;
+
+// Material no layout std430 (igual ao struct Material do phong.fs)
+struct GpuMaterial
+{
+	float ka = 0.0f, kd = 0.0f, ks = 0.0f, q = 1.0f;
+};
+
+static_assert(sizeof(GpuMaterial) == 16, "GpuMaterial fora do layout std430");
+
+// Atributo por instância com o índice do material
+struct MaterialIndex : VertexAttr<4, GLuint, 1>
+{
+	static constexpr const char *name = "materialIndex";
+};
+using MaterialIndexStream = VertexLayout<MaterialIndex>;
+
+class MaterialRegistry
+{
+public:
+	// Maior índice que pode chegar pelo atributo (tamanho do buffer de índices)
+	static const GLuint MAX_MATERIALS = 1024;
+
+	void create(GpuMemoryRegistry *registry = nullptr)
+	{
+		this->registry = registry;
+
+		// Buffer de índices: instância i lê o número i
+		std::vector<GLuint> indices(MAX_MATERIALS);
+		for (GLuint i = 0; i < MAX_MATERIALS; i++)
+			indices[i] = i;
+		glGenBuffers(1, &indexBuffer);
+		glState.bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &storage);
+		if (registry)
+		{
+			registry->trackBuffer(indexBuffer, GL_ARRAY_BUFFER, indices.size() * sizeof(GLuint), GpuSubsystem::Uniforms, "material indices");
+			registry->trackBuffer(storage, GL_SHADER_STORAGE_BUFFER, 0, GpuSubsystem::Uniforms, "materials");
+		}
+	}
+
+	// Adiciona um material e retorna o índice dele
+	GLuint add(const GpuMaterial &material)
+	{
+		if (materials.size() >= MAX_MATERIALS)
+		{
+			std::cout << "ERROR::MATERIAL::TOO_MANY_MATERIALS (max " << MAX_MATERIALS << ")" << std::endl;
+			return 0;
+		}
+		materials.push_back(material);
+		markDirty((GLuint)materials.size() - 1);
+		return (GLuint)materials.size() - 1;
+	}
+
+	void set(GLuint index, const GpuMaterial &material)
+	{
+		if (index >= materials.size())
+			return;
+		materials[index] = material;
+		markDirty(index);
+	}
+
+	const GpuMaterial &get(GLuint index) const { return materials[index]; }
+	size_t size() const { return materials.size(); }
+
+	// Envia os materiais alterados (só a faixa suja) e liga o buffer ao ponto do shader
+	void upload()
+	{
+		if (dirtyBegin < dirtyEnd)
+		{
+			glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, storage);
+			if (materials.size() > capacity)
+			{
+				// Cresce em potências de 2 e reenvia tudo
+				capacity = std::max<size_t>(capacity * 2, 16);
+				while (capacity < materials.size())
+					capacity *= 2;
+				glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GpuMaterial), NULL, GL_DYNAMIC_DRAW);
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, materials.size() * sizeof(GpuMaterial), materials.data());
+				if (registry)
+					registry->resize(GpuResourceType::Buffer, storage, capacity * sizeof(GpuMaterial));
+			}
+			else
+			{
+				glBufferSubData(GL_SHADER_STORAGE_BUFFER, dirtyBegin * sizeof(GpuMaterial), (dirtyEnd - dirtyBegin) * sizeof(GpuMaterial),
+								materials.data() + dirtyBegin);
+			}
+			glState.bindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			dirtyBegin = dirtyEnd = 0;
+		}
+		bind();
+	}
+
+	void bind() const
+	{
+		if (capacity)
+			glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_STORAGE_BINDING, storage);
+	}
+
+	// Liga o atributo materialIndex ao VAO (uma vez por VAO)
+	void attach(GLuint vao) const
+	{
+		if (!glx::DrawArraysInstancedBaseInstance)
+			return; // o índice vai como valor constante no draw()
+		glState.bindVertexArray(vao);
+		glState.bindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+		MaterialIndexStream::setup(0, 1);
+		glState.bindBuffer(GL_ARRAY_BUFFER, 0);
+		glState.bindVertexArray(0);
+	}
+
+	// Desenha com o material indicado (o VAO já vinculado precisa ter passado por attach())
+	void draw(GLenum mode, GLint first, GLsizei count, GLuint material) const
+	{
+		if (glx::DrawArraysInstancedBaseInstance)
+		{
+			glx::DrawArraysInstancedBaseInstance(mode, first, count, 1, material);
+		}
+		else
+		{
+			glVertexAttribI4ui(MaterialIndex::location, material, 0, 0, 0);
+			glDrawArrays(mode, first, count);
+		}
+	}
+
+	// Mesmo que draw(), para malhas com índices (GL_UNSIGNED_INT, relativos a baseVertex)
+	void drawElements(GLenum mode, GLsizei count, GLuint firstIndex, GLint baseVertex, GLuint material) const
+	{
+		const GLvoid *indices = (const GLvoid *)(firstIndex * sizeof(GLuint));
+		if (glx::DrawElementsInstancedBaseVertexBaseInstance)
+		{
+			glx::DrawElementsInstancedBaseVertexBaseInstance(mode, count, GL_UNSIGNED_INT, indices, 1, baseVertex, material);
+		}
+		else
+		{
+			glVertexAttribI4ui(MaterialIndex::location, material, 0, 0, 0);
+			glDrawElementsBaseVertex(mode, count, GL_UNSIGNED_INT, indices, baseVertex);
+		}
+	}
+
+	void destroy()
+	{
+		GLuint buffers[2] = {indexBuffer, storage};
+		for (GLuint id : buffers)
+		{
+			if (!id)
+				continue;
+			if (registry)
+				registry->release(GpuResourceType::Buffer, id);
+			else
+			{
+				glState.forgetBuffer(id);
+				glDeleteBuffers(1, &id);
+			}
+		}
+		indexBuffer = storage = 0;
+		capacity = 0;
+	}
+
+private:
+	std::vector<GpuMaterial> materials;
+	GLuint indexBuffer = 0, storage = 0;
+	size_t capacity = 0;
+	size_t dirtyBegin = 0, dirtyEnd = 0;
+	GpuMemoryRegistry *registry = nullptr;
+
+	void markDirty(GLuint index)
+	{
+		if (dirtyBegin == dirtyEnd)
+		{
+			dirtyBegin = index;
+			dirtyEnd = index + 1;
+			return;
+		}
+		dirtyBegin = std::min<size_t>(dirtyBegin, index);
+		dirtyEnd = std::max<size_t>(dirtyEnd, index + 1);
+	}
+};
@@ -0,0 +1,449 @@
+// Oclusão por software: buffer de profundidade mascarado de baixa resolução na CPU
+//
+// Os oclusores (malhas simplificadas dos objetos grandes) são rasterizados num buffer
+// pequeno (384x192 por padrão) dividido em tiles de 32x8 pixels. Cada tile não guarda a
+// profundidade de cada pixel, só duas camadas (Hasselgren, Andersson e Akenine-Möller,
+// "Masked Software Occlusion Culling", HPG 2016):
+//   zMax0       - profundidade máxima do tile inteiro (o "fundo")
+//   zMax1, mask - os pixels marcados na máscara (1 bit por pixel) estão a no máximo zMax1
+// Um triângulo entra com a sua profundidade máxima: junta-se à camada 1 e, quando a
+// máscara cobre o tile inteiro, a camada 1 vira o novo fundo. Se a camada 1 estiver
+// longe demais do triângulo novo, ela é descartada antes (heurística do artigo).
+// As profundidades só podem ficar maiores que as reais, então o teste erra para o lado
+// de desenhar a mais. A exceção é a borda dos oclusores: a cobertura usa o centro do
+// pixel, como a GPU, e um objeto pode sumir se aparecer menos de um pixel do buffer.
+//
+// Cada quadro: begin() -> addOccluder()... -> rasterize(jobs) -> isVisible() à vontade
+// (isVisible é só leitura e pode ser chamado de várias threads ao mesmo tempo).
+// A transformação e o recorte dos triângulos são divididos em blocos pelo JobSystem; a
+// rasterização é dividida por linhas de tiles, uma tarefa por linha (sem trava: cada
+// tarefa escreve só nos seus tiles). Os limites de cada linha de pixels dentro de um
+// triângulo são calculados com SSE2, 4 linhas por vez.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+//GLM
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_SSE2 1
+#endif
+
+#include "JobSystem.h"
+#include "Visibility.h"
+
+// Malha de oclusão: só posições e índices (espaço do modelo)
+struct OccluderMesh
+{
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+
+	size_t triangleCount() const { return indices.size() / 3; }
+
+	// Fica só com os maxTriangles triângulos de maior área. Tirar triângulos de um
+	// oclusor só diminui o que ele esconde, então a simplificação é sempre segura.
+	void simplify(size_t maxTriangles)
+	{
+		size_t count = triangleCount();
+		if (count <= maxTriangles)
+			return;
+		std::vector<std::pair<float, uint32_t>> areas(count);
+		for (size_t t = 0; t < count; t++)
+		{
+			const glm::vec3 &a = positions[indices[3 * t]], &b = positions[indices[3 * t + 1]], &c = positions[indices[3 * t + 2]];
+			areas[t] = {glm::length(glm::cross(b - a, c - a)), (uint32_t)t};
+		}
+		std::nth_element(areas.begin(), areas.begin() + maxTriangles, areas.end(),
+						 [](const auto &x, const auto &y) { return x.first > y.first; });
+		std::vector<uint32_t> kept;
+		kept.reserve(maxTriangles * 3);
+		for (size_t i = 0; i < maxTriangles; i++)
+			for (int k = 0; k < 3; k++)
+				kept.push_back(indices[3 * areas[i].second + k]);
+		indices.swap(kept);
+	}
+};
+
+class OcclusionBuffer
+{
+public:
+	static const int TILE_WIDTH = 32, TILE_HEIGHT = 8;
+
+	// Dimensões arredondadas para múltiplos do tile
+	void create(int width, int height)
+	{
+		tilesX = std::max(1, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+		tilesY = std::max(1, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+		bufferWidth = tilesX * TILE_WIDTH;
+		bufferHeight = tilesY * TILE_HEIGHT;
+		tiles.assign(tilesX * tilesY, Tile());
+	}
+
+	// Começa um quadro: limpa o buffer e descarta os oclusores anteriores
+	void begin(const glm::mat4 &viewProjection)
+	{
+		this->viewProjection = viewProjection;
+		occluders.clear();
+		for (Tile &t : tiles)
+			t = Tile();
+	}
+
+	// O oclusor precisa continuar existindo até rasterize()
+	void addOccluder(const OccluderMesh &mesh, const glm::mat4 &model)
+	{
+		if (mesh.triangleCount())
+			occluders.push_back({&mesh, viewProjection * model});
+	}
+
+	void rasterize(JobSystem &jobs)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		// Índice global do primeiro triângulo de cada oclusor
+		firstTriangle.resize(occluders.size() + 1);
+		firstTriangle[0] = 0;
+		for (size_t i = 0; i < occluders.size(); i++)
+			firstTriangle[i + 1] = firstTriangle[i] + occluders[i].mesh->triangleCount();
+
+		// Transformação, recorte no plano próximo e projeção para pixels
+		triangles.build(jobs, firstTriangle.back(), 256, [&](size_t first, size_t last, auto &emit) {
+			size_t o = std::upper_bound(firstTriangle.begin(), firstTriangle.end(), first) - firstTriangle.begin() - 1;
+			for (size_t t = first; t < last; t++)
+			{
+				while (t >= firstTriangle[o + 1])
+					o++;
+				const Occluder &occluder = occluders[o];
+				const uint32_t *index = &occluder.mesh->indices[3 * (t - firstTriangle[o])];
+				glm::vec4 clip[3];
+				for (int k = 0; k < 3; k++)
+					clip[k] = occluder.mvp * glm::vec4(occluder.mesh->positions[index[k]], 1.0f);
+				clipAndEmit(clip, emit);
+			}
+		});
+
+		// Uma tarefa por linha de tiles
+		const std::vector<ScreenTriangle> &list = triangles.merged(0);
+		jobs.parallelFor(0, tilesY, 1, [&](size_t first, size_t last) {
+			for (size_t row = first; row < last; row++)
+				rasterizeTileRow((int)row, list);
+		});
+
+		lastRaster = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Caixa alinhada aos eixos (mundo). Falso só se estiver inteira atrás dos oclusores.
+	bool isVisible(const glm::vec3 &boxMin, const glm::vec3 &boxMax) const
+	{
+		float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, minZ = 1e30f;
+		for (int c = 0; c < 8; c++)
+		{
+			glm::vec3 corner((c & 1) ? boxMax.x : boxMin.x, (c & 2) ? boxMax.y : boxMin.y, (c & 4) ? boxMax.z : boxMin.z);
+			glm::vec4 clip = viewProjection * glm::vec4(corner, 1.0f);
+			// Cruza o plano próximo: a projeção não vale, considera visível
+			if (clip.z < -clip.w || clip.w <= NEAR_EPSILON)
+				return true;
+			float invW = 1.0f / clip.w;
+			float x = (clip.x * invW * 0.5f + 0.5f) * bufferWidth;
+			float y = (clip.y * invW * 0.5f + 0.5f) * bufferHeight;
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minY = std::min(minY, y);
+			maxY = std::max(maxY, y);
+			minZ = std::min(minZ, clip.z * invW * 0.5f + 0.5f);
+		}
+		int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(bufferWidth - 1, (int)std::floor(maxX));
+		int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(bufferHeight - 1, (int)std::floor(maxY));
+		if (x0 > x1 || y0 > y1)
+			return false; // fora da tela
+
+		for (int ty = y0 / TILE_HEIGHT; ty <= y1 / TILE_HEIGHT; ty++)
+		{
+			int rowBegin = std::max(y0 - ty * TILE_HEIGHT, 0), rowEnd = std::min(y1 - ty * TILE_HEIGHT, TILE_HEIGHT - 1);
+			for (int tx = x0 / TILE_WIDTH; tx <= x1 / TILE_WIDTH; tx++)
+			{
+				const Tile &tile = tiles[ty * tilesX + tx];
+				if (minZ < tile.zMax1)
+					return true; // mais perto que tudo no tile
+				if (minZ >= tile.zMax0)
+					continue; // atrás do fundo
+				// Entre as camadas: escondida só se todos os seus pixels estiverem na máscara
+				uint32_t columns = spanMask(x0 - tx * TILE_WIDTH, x1 - tx * TILE_WIDTH);
+				for (int r = rowBegin; r <= rowEnd; r++)
+					if (columns & ~tile.mask[r])
+						return true;
+			}
+		}
+		return false;
+	}
+
+	size_t triangleCount() const { return triangles.size(); }
+	// Tempo do último rasterize() (transformação + rasterização), em microssegundos
+	double lastRasterMicroseconds() const { return lastRaster; }
+	int width() const { return bufferWidth; }
+	int height() const { return bufferHeight; }
+
+private:
+	static constexpr float NEAR_EPSILON = 1e-5f;
+
+	struct Tile
+	{
+		float zMax0 = 1.0f;			  // fundo: limite de todos os pixels do tile
+		float zMax1 = 0.0f;			  // limite dos pixels marcados em mask
+		uint32_t mask[TILE_HEIGHT] = {}; // bit x da linha y: pixel coberto pela camada 1
+	};
+
+	// Triângulo já em pixels (y para cima), profundidade em [0, 1]
+	struct ScreenTriangle
+	{
+		float x[3], y[3];
+		float zMax;
+		int yMin, yMax;
+	};
+
+	struct Occluder
+	{
+		const OccluderMesh *mesh;
+		glm::mat4 mvp;
+	};
+
+	// Aresta: dentro quando a * x + b * y + c >= 0
+	struct Edge
+	{
+		float a, b, c;
+	};
+
+	int tilesX = 0, tilesY = 0, bufferWidth = 0, bufferHeight = 0;
+	std::vector<Tile> tiles;
+	glm::mat4 viewProjection = glm::mat4(1);
+	std::vector<Occluder> occluders;
+	std::vector<size_t> firstTriangle;
+	ParallelDrawLists<ScreenTriangle> triangles{1};
+	double lastRaster = 0.0;
+
+	// Bits de first a last (inclusive) recortados para [0, 31]
+	static uint32_t spanMask(int first, int last)
+	{
+		first = std::max(first, 0);
+		last = std::min(last, TILE_WIDTH - 1);
+		if (first > last)
+			return 0;
+		uint32_t upTo = last == 31 ? 0xFFFFFFFFu : ((1u << (last + 1)) - 1u);
+		return upTo & ~((1u << first) - 1u);
+	}
+
+	// Recorta no plano próximo (z >= -w) e emite um ou dois triângulos em pixels
+	template <typename Emit>
+	void clipAndEmit(const glm::vec4 clip[3], Emit &emit) const
+	{
+		glm::vec4 polygon[4];
+		int count = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			const glm::vec4 &a = clip[i], &b = clip[(i + 1) % 3];
+			float da = a.z + a.w, db = b.z + b.w;
+			if (da >= 0.0f)
+				polygon[count++] = a;
+			if ((da >= 0.0f) != (db >= 0.0f))
+				polygon[count++] = a + (b - a) * (da / (da - db));
+		}
+		if (count < 3)
+			return;
+
+		float x[4], y[4], z[4];
+		for (int i = 0; i < count; i++)
+		{
+			float invW = 1.0f / std::max(polygon[i].w, NEAR_EPSILON);
+			x[i] = (polygon[i].x * invW * 0.5f + 0.5f) * bufferWidth;
+			y[i] = (polygon[i].y * invW * 0.5f + 0.5f) * bufferHeight;
+			z[i] = std::min(std::max(polygon[i].z * invW * 0.5f + 0.5f, 0.0f), 1.0f);
+		}
+		for (int i = 1; i + 1 < count; i++)
+		{
+			ScreenTriangle tri;
+			int v[3] = {0, i, i + 1};
+			float minX = 1e30f, maxX = -1e30f, minY = 1e30f, maxY = -1e30f;
+			tri.zMax = 0.0f;
+			for (int k = 0; k < 3; k++)
+			{
+				tri.x[k] = x[v[k]];
+				tri.y[k] = y[v[k]];
+				tri.zMax = std::max(tri.zMax, z[v[k]]);
+				minX = std::min(minX, tri.x[k]);
+				maxX = std::max(maxX, tri.x[k]);
+				minY = std::min(minY, tri.y[k]);
+				maxY = std::max(maxY, tri.y[k]);
+			}
+			if (maxX < 0.0f || minX > bufferWidth || maxY < 0.0f || minY > bufferHeight)
+				continue;
+			tri.yMin = std::max(0, (int)std::floor(minY));
+			tri.yMax = std::min(bufferHeight - 1, (int)std::ceil(maxY));
+			emit(0, tri);
+		}
+	}
+
+	// Arestas com orientação anti-horária; falso para triângulos degenerados
+	static bool setupEdges(const ScreenTriangle &tri, Edge edges[3])
+	{
+		float x[3] = {tri.x[0], tri.x[1], tri.x[2]}, y[3] = {tri.y[0], tri.y[1], tri.y[2]};
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (std::fabs(area) < 1e-8f)
+			return false;
+		if (area < 0.0f)
+		{
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			int j = (i + 1) % 3;
+			float dx = x[j] - x[i], dy = y[j] - y[i];
+			edges[i] = {-dy, dx, dy * x[i] - dx * y[i]};
+		}
+		return true;
+	}
+
+	// Primeiro e último pixel cobertos (centro do pixel dentro) em 4 linhas seguidas a
+	// partir de "row"; first > last quando a linha não tem pixel coberto
+	static void rowSpans(const Edge edges[3], int row, int first[4], int last[4], int width)
+	{
+#ifdef OCCLUSION_SSE2
+		__m128 py = _mm_add_ps(_mm_set1_ps((float)row + 0.5f), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+		__m128 left = _mm_set1_ps(-1e6f), right = _mm_set1_ps(1e6f);
+		for (int e = 0; e < 3; e++)
+		{
+			const Edge &edge = edges[e];
+			// b * y + c: parte da aresta que não depende de x
+			__m128 rest = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge.b), py), _mm_set1_ps(edge.c));
+			if (edge.a == 0.0f)
+			{
+				// Aresta horizontal: a linha inteira fica dentro ou fora
+				__m128 outside = _mm_cmplt_ps(rest, _mm_setzero_ps());
+				left = _mm_or_ps(_mm_and_ps(outside, _mm_set1_ps(1e6f)), _mm_andnot_ps(outside, left));
+				continue;
+			}
+			__m128 cross = _mm_mul_ps(rest, _mm_set1_ps(-1.0f / edge.a)); // x onde a aresta cruza a linha
+			if (edge.a > 0.0f)
+				left = _mm_max_ps(left, cross);
+			else
+				right = _mm_min_ps(right, cross);
+		}
+		// Pixel x coberto quando x + 0.5 está em [left, right]
+		left = _mm_min_ps(_mm_max_ps(_mm_sub_ps(left, _mm_set1_ps(0.5f)), _mm_set1_ps(-1.0f)), _mm_set1_ps((float)width + 1.0f));
+		right = _mm_min_ps(_mm_max_ps(_mm_sub_ps(right, _mm_set1_ps(0.5f)), _mm_set1_ps(-2.0f)), _mm_set1_ps((float)width));
+		// ceil(left) = -floor(-left); floor(v) = trunc(v) - (v < trunc(v))
+		__m128 negLeft = _mm_sub_ps(_mm_setzero_ps(), left);
+		__m128i t = _mm_cvttps_epi32(negLeft);
+		t = _mm_add_epi32(t, _mm_castps_si128(_mm_cmplt_ps(negLeft, _mm_cvtepi32_ps(t))));
+		__m128i firstX = _mm_sub_epi32(_mm_setzero_si128(), t);
+		t = _mm_cvttps_epi32(right);
+		__m128i lastX = _mm_add_epi32(t, _mm_castps_si128(_mm_cmplt_ps(right, _mm_cvtepi32_ps(t))));
+		_mm_storeu_si128((__m128i *)first, firstX);
+		_mm_storeu_si128((__m128i *)last, lastX);
+#else
+		for (int r = 0; r < 4; r++)
+		{
+			float py = row + r + 0.5f;
+			float left = -1e6f, right = 1e6f;
+			for (int e = 0; e < 3; e++)
+			{
+				const Edge &edge = edges[e];
+				float rest = edge.b * py + edge.c;
+				if (edge.a == 0.0f)
+				{
+					if (rest < 0.0f)
+						left = 1e6f;
+					continue;
+				}
+				float cross = -rest / edge.a;
+				if (edge.a > 0.0f)
+					left = std::max(left, cross);
+				else
+					right = std::min(right, cross);
+			}
+			left = std::min(std::max(left - 0.5f, -1.0f), (float)width + 1.0f);
+			right = std::min(std::max(right - 0.5f, -2.0f), (float)width);
+			first[r] = (int)std::ceil(left);
+			last[r] = (int)std::floor(right);
+		}
+#endif
+	}
+
+	void rasterizeTileRow(int tileRow, const std::vector<ScreenTriangle> &list)
+	{
+		int rowBase = tileRow * TILE_HEIGHT;
+		Tile *rowTiles = &tiles[tileRow * tilesX];
+		for (const ScreenTriangle &tri : list)
+		{
+			if (tri.yMax < rowBase || tri.yMin >= rowBase + TILE_HEIGHT)
+				continue;
+			Edge edges[3];
+			if (!setupEdges(tri, edges))
+				continue;
+
+			int first[TILE_HEIGHT], last[TILE_HEIGHT];
+			for (int r = 0; r < TILE_HEIGHT; r += 4)
+				rowSpans(edges, rowBase + r, first + r, last + r, bufferWidth);
+			int minX = bufferWidth, maxX = -1;
+			for (int r = 0; r < TILE_HEIGHT; r++)
+			{
+				first[r] = std::max(first[r], 0);
+				last[r] = std::min(last[r], bufferWidth - 1);
+				if (first[r] <= last[r])
+				{
+					minX = std::min(minX, first[r]);
+					maxX = std::max(maxX, last[r]);
+				}
+			}
+			if (minX > maxX)
+				continue;
+
+			for (int tx = minX / TILE_WIDTH; tx <= maxX / TILE_WIDTH; tx++)
+			{
+				uint32_t coverage[TILE_HEIGHT];
+				uint32_t any = 0;
+				for (int r = 0; r < TILE_HEIGHT; r++)
+				{
+					coverage[r] = spanMask(first[r] - tx * TILE_WIDTH, last[r] - tx * TILE_WIDTH);
+					any |= coverage[r];
+				}
+				if (any)
+					mergeIntoTile(rowTiles[tx], coverage, tri.zMax);
+			}
+		}
+	}
+
+	static void mergeIntoTile(Tile &tile, const uint32_t coverage[TILE_HEIGHT], float zTriangle)
+	{
+		if (zTriangle >= tile.zMax0)
+			return; // atrás de tudo que já está no tile
+		// Camada 1 bem mais longe do triângulo do que do fundo: não vale a pena mantê-la
+		if (tile.zMax1 - zTriangle > tile.zMax0 - tile.zMax1)
+		{
+			tile.zMax1 = 0.0f;
+			for (uint32_t &m : tile.mask)
+				m = 0;
+		}
+		tile.zMax1 = std::max(tile.zMax1, zTriangle);
+		bool full = true;
+		for (int r = 0; r < TILE_HEIGHT; r++)
+		{
+			tile.mask[r] |= coverage[r];
+			full = full && tile.mask[r] == 0xFFFFFFFFu;
+		}
+		if (full)
+		{
+			// Tile todo coberto: a camada 1 vira o novo fundo
+			tile.zMax0 = tile.zMax1;
+			tile.zMax1 = 0.0f;
+			for (uint32_t &m : tile.mask)
+				m = 0;
+		}
+	}
+};
@@ -0,0 +1,229 @@
+// Tabela de pipelines (programa + formato de vértice + formato do alvo) pré-aquecidos
+//
+// Muitos drivers só terminam de compilar o programa no primeiro desenho com um
+// determinado VAO e formato de framebuffer, o que aparece como um pico no quadro.
+// A cena declara na inicialização todas as combinações que vai usar; warmUp() faz um
+// desenho de poucos vértices com cada uma num framebuffer fora da tela do mesmo
+// formato, durante o carregamento. Programas que ainda estão compilando em segundo
+// plano são aquecidos por update() assim que ficam prontos, e o laço só passa a
+// usá-los depois disso (warmed()).
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "Shader.h"
+#include "GLStateCache.h"
+
+// Formato do alvo de desenho (0 = sem o anexo)
+struct RenderTargetFormat
+{
+	GLenum color = GL_RGBA8;
+	GLenum depth = GL_DEPTH_COMPONENT24;
+
+	bool operator==(const RenderTargetFormat &other) const { return color == other.color && depth == other.depth; }
+};
+
+class PipelineTable
+{
+public:
+	// vao: um VAO qualquer com o formato de vértice (e dados) da combinação
+	void add(const std::string &name, const Shader &program, GLuint vao, RenderTargetFormat format = RenderTargetFormat(),
+			 GLenum primitive = GL_TRIANGLES, bool indexed = false)
+	{
+		Pipeline p;
+		p.name = name;
+		p.program = &program;
+		p.vao = vao;
+		p.format = format;
+		p.primitive = primitive;
+		p.indexed = indexed;
+		pipelines.push_back(p);
+	}
+
+	// Aquece as combinações cujos programas já estão prontos; retorna quantas faltam
+	int warmUp()
+	{
+		int pending = 0;
+		// Um programa que falhou também conta: marcá-lo libera os alvos quando for o último
+		bool any = false;
+		for (Pipeline &p : pipelines)
+			if (!p.warmed && (p.program->ready() || p.program->failed()))
+				any = true;
+		if (!any)
+			return countPending();
+
+		GLint viewport[4], framebuffer = 0;
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+		for (Pipeline &p : pipelines)
+		{
+			if (p.warmed)
+				continue;
+			if (p.program->failed())
+			{
+				p.warmed = true; // nada a aquecer, o laço usa o substituto
+				continue;
+			}
+			if (!p.program->ready())
+			{
+				pending++;
+				continue;
+			}
+			draw(p);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+		// Garante que o driver processou (e compilou) os desenhos ainda no carregamento
+		glFinish();
+
+		if (pending == 0)
+			releaseTargets();
+		return pending;
+	}
+
+	// Chamado por quadro enquanto houver programas compilando em segundo plano
+	int update()
+	{
+		return countPending() ? warmUp() : 0;
+	}
+
+	// true quando todas as combinações do programa já foram aquecidas
+	bool warmed(const Shader &program) const
+	{
+		for (const Pipeline &p : pipelines)
+			if (p.program == &program && !p.warmed)
+				return false;
+		return true;
+	}
+
+	size_t size() const { return pipelines.size(); }
+
+	int warmedCount() const
+	{
+		int count = 0;
+		for (const Pipeline &p : pipelines)
+			count += p.warmed ? 1 : 0;
+		return count;
+	}
+
+private:
+	struct Pipeline
+	{
+		std::string name;
+		const Shader *program = nullptr;
+		GLuint vao = 0;
+		RenderTargetFormat format;
+		GLenum primitive = GL_TRIANGLES;
+		bool indexed = false;
+		bool warmed = false;
+	};
+
+	// Framebuffer fora da tela de um formato
+	struct Target
+	{
+		RenderTargetFormat format;
+		GLuint fbo = 0, color = 0, depth = 0;
+	};
+
+	static const int TARGET_SIZE = 8;
+
+	std::vector<Pipeline> pipelines;
+	std::vector<Target> targets;
+
+	int countPending() const
+	{
+		int pending = 0;
+		for (const Pipeline &p : pipelines)
+			pending += p.warmed ? 0 : 1;
+		return pending;
+	}
+
+	void draw(Pipeline &p)
+	{
+		p.warmed = true;
+		if (!glIsVertexArray(p.vao))
+		{
+			std::cout << "ERROR::PIPELINE::INVALID_VERTEX_ARRAY " << p.name << std::endl;
+			return;
+		}
+		const Target *target = targetFor(p.format);
+		if (!target)
+			return;
+		glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+		glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+		p.program->Use();
+		glState.bindVertexArray(p.vao);
+		// Um primitivo basta: o que importa é o driver montar o programa para esse estado
+		GLsizei count = p.primitive == GL_LINES ? 2 : (p.primitive == GL_POINTS ? 1 : 3);
+		if (p.indexed)
+			glDrawElements(p.primitive, count, GL_UNSIGNED_INT, 0);
+		else
+			glDrawArrays(p.primitive, 0, count);
+		glState.bindVertexArray(0);
+	}
+
+	const Target *targetFor(const RenderTargetFormat &format)
+	{
+		for (const Target &t : targets)
+			if (t.format == format)
+				return &t;
+
+		Target t;
+		t.format = format;
+		glGenFramebuffers(1, &t.fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+		if (format.color)
+		{
+			glGenRenderbuffers(1, &t.color);
+			glBindRenderbuffer(GL_RENDERBUFFER, t.color);
+			glRenderbufferStorage(GL_RENDERBUFFER, format.color, TARGET_SIZE, TARGET_SIZE);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t.color);
+		}
+		else
+		{
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		if (format.depth)
+		{
+			glGenRenderbuffers(1, &t.depth);
+			glBindRenderbuffer(GL_RENDERBUFFER, t.depth);
+			glRenderbufferStorage(GL_RENDERBUFFER, format.depth, TARGET_SIZE, TARGET_SIZE);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, t.depth);
+		}
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR::PIPELINE::FRAMEBUFFER_INCOMPLETE" << std::endl;
+			deleteTarget(t);
+			return nullptr;
+		}
+		targets.push_back(t);
+		return &targets.back();
+	}
+
+	static void deleteTarget(Target &t)
+	{
+		if (t.color)
+			glDeleteRenderbuffers(1, &t.color);
+		if (t.depth)
+			glDeleteRenderbuffers(1, &t.depth);
+		if (t.fbo)
+			glDeleteFramebuffers(1, &t.fbo);
+		t = Target();
+	}
+
+	// Os alvos só servem para o aquecimento
+	void releaseTargets()
+	{
+		for (Target &t : targets)
+			deleteTarget(t);
+		targets.clear();
+	}
+};
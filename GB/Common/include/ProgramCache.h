@@ -0,0 +1,159 @@
+// Cache em disco dos binários de programas de shader (glGetProgramBinary/glProgramBinary)
+//
+// A chave é um hash dos códigos-fonte, dos #defines e das strings do driver
+// (fabricante, renderizador e versão), então trocar o shader ou atualizar o driver
+// gera outra entrada. Se o driver recusar um binário salvo (GL_LINK_STATUS falso),
+// o arquivo é descartado e o programa é compilado a partir do código-fonte.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <filesystem>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLExtensoes.h"
+
+namespace programcache
+{
+	// Pasta dos binários (relativa ao diretório de execução). Vazia desliga o cache.
+	inline std::string directory = "shader_cache";
+
+	// Estatísticas da execução
+	inline int hits = 0;
+	inline int misses = 0;
+	inline int rejected = 0;
+
+	const uint32_t MAGIC = 0x42505347; // "GSPB"
+
+	struct FileHeader
+	{
+		uint32_t magic;
+		uint32_t format;
+		uint64_t key;
+		uint64_t length;
+	};
+
+	// FNV-1a de 64 bits, acumulativo
+	inline uint64_t hash(const std::string &data, uint64_t h = 14695981039346656037ull)
+	{
+		for (unsigned char c : data)
+			h = (h ^ c) * 1099511628211ull;
+		return h;
+	}
+
+	inline bool available()
+	{
+		if (directory.empty() || !glx::ProgramBinary || !glx::GetProgramBinary || !glx::ProgramParameteri)
+			return false;
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}
+
+	// Chave do programa: fontes de todos os estágios + defines + driver
+	inline uint64_t key(const std::vector<std::string> &sources, const std::string &defines)
+	{
+		uint64_t h = hash(defines);
+		for (const std::string &src : sources)
+			h = hash(src, hash("\x1f", h)); // separador entre estágios
+		const char *driver[3] = {(const char *)glGetString(GL_VENDOR), (const char *)glGetString(GL_RENDERER),
+								 (const char *)glGetString(GL_VERSION)};
+		for (const char *str : driver)
+			h = hash(str ? str : "", h);
+		return h;
+	}
+
+	inline std::string path(uint64_t key)
+	{
+		std::ostringstream name;
+		name << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+		return name.str();
+	}
+
+	// Tenta carregar o binário no programa. Retorna true se o programa ficou ligado.
+	inline bool load(GLuint program, uint64_t key)
+	{
+		if (!available())
+			return false;
+
+		std::ifstream file(path(key), std::ios::binary);
+		if (!file)
+		{
+			misses++;
+			return false;
+		}
+		FileHeader header;
+		std::vector<char> binary;
+		if (file.read((char *)&header, sizeof(header)) && header.magic == MAGIC && header.key == key)
+		{
+			binary.resize((size_t)header.length);
+			file.read(binary.data(), binary.size());
+		}
+		bool valid = !binary.empty() && (size_t)file.gcount() == binary.size();
+		file.close();
+
+		GLint linked = GL_FALSE;
+		if (valid)
+		{
+			glx::ProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+			glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		}
+		if (!linked)
+		{
+			// Binário corrompido ou de outra versão do driver: será recompilado e salvo de novo
+			rejected++;
+			std::error_code ec;
+			std::filesystem::remove(path(key), ec);
+			return false;
+		}
+		hits++;
+		return true;
+	}
+
+	// Pede ao driver para manter o binário disponível (antes do glLinkProgram)
+	inline void prepare(GLuint program)
+	{
+		if (available())
+			glx::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// Salva o binário de um programa já ligado
+	inline void save(GLuint program, uint64_t key)
+	{
+		if (!available())
+			return;
+
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		glx::GetProgramBinary(program, length, NULL, &format, binary.data());
+
+		std::error_code ec;
+		std::filesystem::create_directories(directory, ec);
+
+		// Escreve num arquivo temporário e renomeia, para não deixar arquivo pela metade
+		std::string finalPath = path(key);
+		std::string tempPath = finalPath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary);
+			if (!file)
+				return;
+			FileHeader header = {MAGIC, format, key, (uint64_t)length};
+			file.write((const char *)&header, sizeof(header));
+			file.write(binary.data(), binary.size());
+		}
+		std::filesystem::rename(tempPath, finalPath, ec);
+		if (ec)
+			std::filesystem::remove(tempPath, ec);
+	}
+}
@@ -0,0 +1,294 @@
+// Fila de desenhos ordenada por chave de 64 bits
+//
+// Qualquer parte do código empurra pacotes de desenho com uma chave; a cada quadro a
+// fila ordena as chaves (radix sort LSD) e entrega os pacotes em
+// ordem para quem faz as chamadas GL. A chave agrupa por estado, do mais caro de trocar
+// para o mais barato, e termina na profundidade:
+//
+//   bits 63-60  passada (profundidade, opacos, transparentes)
+//   bits 59-48  programa
+//   bits 47-32  textura/material
+//   bits 31-20  VAO
+//   bits 19-0   profundidade quantizada (frente para trás; invertida nos transparentes)
+//
+// Só os transparentes usam os 20 bits de profundidade: nas passadas de profundidade e de
+// opacos a ordem da frente para trás só serve ao early-Z, e os 11 bits de cima (passos de
+// 1/2048 do plano distante) bastam. Os de baixo ficam zerados e saem da ordenação.
+//
+// Os identificadores entram truncados nos bits do campo: nomes GL diferentes podem
+// colidir, o que só piora o agrupamento, nunca a imagem.
+//
+// A ordenação só olha os bits que variam entre as chaves do quadro (poucos programas,
+// texturas e VAOs deixam a maior parte dos campos constante): esses bits são juntados
+// numa chave compacta, com a posição do pacote nos bits de baixo, e o radix roda sobre
+// esses valores de 8 bytes, com até 11 bits por passada. Se não couberem em 64 bits,
+// ordena as chaves inteiras, 8 bits por passada, pulando os bytes iguais em todas.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+
+//GLAD
+#include <glad/glad.h>
+
+// Ordem das passadas na chave
+enum RenderPass
+{
+	PASS_DEPTH = 0,
+	PASS_OPAQUE = 1,
+	PASS_TRANSPARENT = 2
+};
+
+namespace sortkey
+{
+	const int PASS_BITS = 4, PROGRAM_BITS = 12, TEXTURE_BITS = 16, VAO_BITS = 12, DEPTH_BITS = 20;
+	// Bits de profundidade usados fora da passada de transparentes
+	const int COARSE_DEPTH_BITS = 11;
+	const int DEPTH_SHIFT = 0;
+	const int VAO_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+	const int TEXTURE_SHIFT = VAO_SHIFT + VAO_BITS;
+	const int PROGRAM_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS;
+	const int PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+	static_assert(PASS_SHIFT + PASS_BITS == 64, "campos da chave devem somar 64 bits");
+
+	inline uint64_t field(uint64_t value, int bits, int shift)
+	{
+		return (value & ((uint64_t(1) << bits) - 1)) << shift;
+	}
+
+	// depth: distância até a câmera dividida pelo plano distante (0 = perto, 1 = longe)
+	inline uint64_t make(RenderPass pass, GLuint program, GLuint texture, GLuint vao, float depth)
+	{
+		const uint64_t maxDepth = (uint64_t(1) << DEPTH_BITS) - 1;
+		uint64_t d = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * maxDepth);
+		// Transparentes são desenhados de trás para frente
+		if (pass == PASS_TRANSPARENT)
+			d = maxDepth - d;
+		else
+			d &= ~((uint64_t(1) << (DEPTH_BITS - COARSE_DEPTH_BITS)) - 1);
+		return field(pass, PASS_BITS, PASS_SHIFT) | field(program, PROGRAM_BITS, PROGRAM_SHIFT) |
+			   field(texture, TEXTURE_BITS, TEXTURE_SHIFT) | field(vao, VAO_BITS, VAO_SHIFT) | field(d, DEPTH_BITS, DEPTH_SHIFT);
+	}
+}
+
+template <typename Packet>
+class RenderQueue
+{
+public:
+	void push(uint64_t key, const Packet &packet)
+	{
+		entries.push_back({key, (uint32_t)packets.size()});
+		packets.push_back(packet);
+		keysAnd &= key;
+		keysOr |= key;
+		sorted = false;
+	}
+
+	void clear()
+	{
+		entries.clear();
+		packets.clear();
+		keysAnd = ~uint64_t(0);
+		keysOr = 0;
+		sorted = true;
+	}
+
+	void reserve(size_t count)
+	{
+		entries.reserve(count);
+		scratch.reserve(count);
+		packets.reserve(count);
+		compact.reserve(count);
+		compactScratch.reserve(count);
+	}
+
+	size_t size() const { return packets.size(); }
+
+	// Radix sort LSD estável sobre as chaves; mede o tempo gasto
+	void sort()
+	{
+		auto start = std::chrono::steady_clock::now();
+		size_t n = entries.size();
+		if (n > 1)
+		{
+			// Trechos contíguos de bits que variam, na ordem do menos para o mais significativo
+			uint64_t varying = keysAnd ^ keysOr;
+			Run runs[32];
+			int runCount = 0, keyBits = 0;
+			for (int bit = 0; bit < 64;)
+			{
+				if (!((varying >> bit) & 1))
+				{
+					bit++;
+					continue;
+				}
+				int end = bit;
+				while (end < 64 && ((varying >> end) & 1))
+					end++;
+				runs[runCount++] = {bit, end - bit == 64 ? ~uint64_t(0) : (uint64_t(1) << (end - bit)) - 1, keyBits};
+				keyBits += end - bit;
+				bit = end;
+			}
+			int indexBits = 1;
+			while ((size_t(1) << indexBits) < n)
+				indexBits++;
+
+			// Chaves todas iguais (keyBits 0): a ordem de chegada já é a ordenada
+			if (keyBits > 0 && keyBits + indexBits <= 64)
+				sortCompact(runs, runCount, keyBits, indexBits);
+			else if (keyBits > 0)
+				sortKeys();
+		}
+		sorted = true;
+		lastSort = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Entrega os pacotes em ordem de chave (ordena antes, se preciso)
+	template <typename Submit>
+	void submit(Submit &&draw)
+	{
+		if (!sorted)
+			sort();
+		for (const Entry &e : entries)
+			draw(packets[e.index]);
+	}
+
+	// Só os pacotes de uma passada, em ordem de chave
+	template <typename Submit>
+	void submit(RenderPass pass, Submit &&draw)
+	{
+		if (!sorted)
+			sort();
+		for (const Entry &e : entries)
+			if ((e.key >> sortkey::PASS_SHIFT) == (uint64_t)pass)
+				draw(packets[e.index]);
+	}
+
+	uint64_t key(size_t i) const { return entries[i].key; }
+	const Packet &packet(size_t i) const { return packets[entries[i].index]; }
+
+	// Tempo da última ordenação, em microssegundos
+	double lastSortMicroseconds() const { return lastSort; }
+
+private:
+	struct Entry
+	{
+		uint64_t key;
+		uint32_t index; // posição do pacote em packets
+	};
+
+	// Trecho de bits da chave que vai para a posição "out" da chave compacta
+	struct Run
+	{
+		int shift;
+		uint64_t mask;
+		int out;
+	};
+
+	static const int MAX_RADIX_BITS = 11;
+
+	std::vector<Entry> entries, scratch;
+	std::vector<Packet> packets;
+	std::vector<uint64_t> compact, compactScratch;
+	std::vector<uint32_t> counts;
+	uint64_t keysAnd = ~uint64_t(0), keysOr = 0;
+	bool sorted = true;
+	double lastSort = 0.0;
+
+	// Ordena valores (chave compacta << indexBits | posição em entries) e reordena entries
+	void sortCompact(const Run *runs, int runCount, int keyBits, int indexBits)
+	{
+		size_t n = entries.size();
+		compact.resize(n);
+		compactScratch.resize(n);
+		// Cópias locais: as escritas em compact não obrigam o compilador a reler os trechos
+		int shifts[32], outs[32];
+		uint64_t masks[32];
+		for (int r = 0; r < runCount; r++)
+		{
+			shifts[r] = runs[r].shift;
+			masks[r] = runs[r].mask;
+			outs[r] = runs[r].out;
+		}
+		const Entry *in = entries.data();
+		uint64_t *out = compact.data();
+		for (size_t i = 0; i < n; i++)
+		{
+			uint64_t key = in[i].key, packed = 0;
+			for (int r = 0; r < runCount; r++)
+				packed |= ((key >> shifts[r]) & masks[r]) << outs[r];
+			out[i] = (packed << indexBits) | i;
+		}
+
+		// Passadas de tamanho igual: 24 bits viram 3 de 8, não 11 + 11 + 2
+		int digits = (keyBits + MAX_RADIX_BITS - 1) / MAX_RADIX_BITS;
+		int radixBits = (keyBits + digits - 1) / digits;
+		uint32_t radixSize = 1u << radixBits, radixMask = radixSize - 1;
+		counts.assign((size_t)digits * radixSize, 0);
+		for (int d = 0; d < digits; d++)
+		{
+			uint32_t *count = &counts[(size_t)d * radixSize];
+			int shift = indexBits + d * radixBits;
+			for (size_t i = 0; i < n; i++)
+				count[(out[i] >> shift) & radixMask]++;
+		}
+		for (int d = 0; d < digits; d++)
+		{
+			uint32_t *offsets = &counts[(size_t)d * radixSize];
+			int shift = indexBits + d * radixBits;
+			const uint64_t *from = compact.data();
+			uint64_t *to = compactScratch.data();
+			if (offsets[(from[0] >> shift) & radixMask] == n)
+				continue;
+			uint32_t sum = 0;
+			for (uint32_t i = 0; i < radixSize; i++)
+			{
+				uint32_t count = offsets[i];
+				offsets[i] = sum;
+				sum += count;
+			}
+			for (size_t i = 0; i < n; i++)
+				to[offsets[(from[i] >> shift) & radixMask]++] = from[i];
+			compact.swap(compactScratch);
+		}
+
+		scratch.resize(n);
+		const uint64_t indexMask = (uint64_t(1) << indexBits) - 1;
+		for (size_t i = 0; i < n; i++)
+			scratch[i] = entries[compact[i] & indexMask];
+		entries.swap(scratch);
+	}
+
+	// Chaves inteiras, 8 bits por passada, para quando a compacta não cabe em 64 bits
+	void sortKeys()
+	{
+		size_t n = entries.size();
+		scratch.resize(n);
+
+		// Histogramas dos 8 bytes numa única leitura das chaves
+		uint32_t byteCounts[8][256] = {};
+		for (const Entry &e : entries)
+			for (int b = 0; b < 8; b++)
+				byteCounts[b][(e.key >> (8 * b)) & 0xFF]++;
+
+		for (int b = 0; b < 8; b++)
+		{
+			// Byte igual em todas as chaves: a passada não mudaria nada
+			if (byteCounts[b][(entries[0].key >> (8 * b)) & 0xFF] == n)
+				continue;
+			uint32_t offsets[256];
+			uint32_t sum = 0;
+			for (int i = 0; i < 256; i++)
+			{
+				offsets[i] = sum;
+				sum += byteCounts[b][i];
+			}
+			for (const Entry &e : entries)
+				scratch[offsets[(e.key >> (8 * b)) & 0xFF]++] = e;
+			entries.swap(scratch);
+		}
+	}
+};
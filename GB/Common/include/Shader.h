@@ -7,6 +7,9 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 //GLAD
 #include <glad/glad.h>
@@ -14,14 +17,75 @@
 // GLFW
 #include <GLFW/glfw3.h>
 
+#include "GLExtensoes.h"
+#include "ProgramCache.h"
+#include "GLStateCache.h"
+
 using namespace std;
 
+// Hash FNV-1a de 32 bits dos nomes de uniforms e atributos
+constexpr uint32_t shaderNameHash(const char *str, size_t length)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; i++)
+		hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+	return hash;
+}
+
+// Nome de uma variável do shader, identificado só pelo hash.
+// Com literais ("view") o hash é calculado em tempo de compilação; para garantir,
+// declare como constexpr: constexpr ShaderName uView = "view";
+struct ShaderName
+{
+	uint32_t hash;
+
+	template <size_t N>
+	constexpr ShaderName(const char (&str)[N]) : hash(shaderNameHash(str, N - 1)) {}
+	ShaderName(const std::string &str) : hash(shaderNameHash(str.c_str(), str.size())) {}
+};
+
+// Entrada da tabela de reflexão montada na ligação do programa
+struct ShaderVariable
+{
+	uint32_t hash;
+	GLint location;
+	GLenum type;  // ex: GL_FLOAT_MAT4
+	GLint size;	  // número de elementos (arrays)
+	std::string name;
+};
+
+// Localização já resolvida de um uniform, para uso no laço de desenho
+struct UniformHandle
+{
+	GLint location = -1;
+	GLenum type = GL_NONE;
+	bool valid() const { return location >= 0; }
+};
+
+enum class ShaderCompileMode
+{
+	Blocking, // compila e verifica no construtor
+	Deferred  // só dispara a compilação; verificar com poll()
+};
+
+enum class ShaderState
+{
+	Pending,
+	Ready,
+	Failed
+};
+
 class Shader
 {
 public:
 	GLuint ID;
+	bool fromCache = false; // programa carregado do cache de binários
 	// Constructor generates the shader on the fly
-	Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
+	// "defines" (ex: "#define TEXTURED\n") é inserido logo depois da linha #version.
+	// Com ShaderCompileMode::Deferred o construtor só dispara a compilação; o programa
+	// fica pronto depois que poll() retornar true (ver ShaderQueue).
+	Shader(const GLchar* vertexPath, const GLchar* fragmentPath, const std::string& defines = "",
+		   ShaderCompileMode mode = ShaderCompileMode::Blocking)
 	{
 		// 1. Retrieve the vertex/fragment source code from filePath
 		std::string vertexCode;
@@ -51,39 +115,115 @@ public:
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 		}
+		vertexCode = injectDefines(vertexCode, defines);
+		fragmentCode = injectDefines(fragmentCode, defines);
+
+		// Com o binário em cache não é preciso compilar nada
+		this->ID = glCreateProgram();
+		cacheKey = programcache::key({vertexCode, fragmentCode}, defines);
+		fromCache = programcache::load(this->ID, cacheKey);
+		if (fromCache)
+		{
+			finishCompile();
+			return;
+		}
+		startCompile(vertexCode, fragmentCode);
+		if (mode == ShaderCompileMode::Blocking)
+			finishCompile();
+	}
+	// Uses the current shader
+	void Use() const
+	{
+		glState.useProgram(this->ID);
+	}
+
+	// Verifica sem bloquear se a compilação terminou. Retorna true quando o programa
+	// está pronto ou falhou. Sem KHR_parallel_shader_compile não há como perguntar
+	// sem esperar, então o resultado é consultado direto.
+	bool poll()
+	{
+		if (state != ShaderState::Pending)
+			return true;
+		if (glx::MaxShaderCompilerThreads)
+		{
+			GLint done = GL_FALSE;
+			glGetProgramiv(this->ID, GL_COMPLETION_STATUS_KHR, &done);
+			if (!done)
+				return false;
+		}
+		finishCompile();
+		return true;
+	}
+
+	bool ready() const { return state == ShaderState::Ready; }
+	bool failed() const { return state == ShaderState::Failed; }
+
+	// Insere os defines depois da diretiva #version (que precisa ser a primeira linha)
+	static std::string injectDefines(const std::string& code, const std::string& defines)
+	{
+		if (defines.empty())
+			return code;
+		size_t pos = 0;
+		if (code.compare(0, 8, "#version") == 0)
+		{
+			pos = code.find('\n');
+			pos = pos == std::string::npos ? code.size() : pos + 1;
+		}
+		std::string text = defines;
+		if (text.back() != '\n')
+			text += '\n';
+		return code.substr(0, pos) + text + code.substr(pos);
+	}
+
+private:
+	// Compila e liga a partir do código-fonte, salvando o binário no cache
+	GLuint vertexShader = 0, fragmentShader = 0;
+	uint64_t cacheKey = 0;
+	ShaderState state = ShaderState::Pending;
+
+	// Envia os fontes e pede a ligação, sem consultar nenhum estado: com
+	// KHR_parallel_shader_compile o driver compila em outras threads
+	void startCompile(const std::string& vertexCode, const std::string& fragmentCode)
+	{
 		const GLchar* vShaderCode = vertexCode.c_str();
 		const GLchar * fShaderCode = fragmentCode.c_str();
 		// 2. Compile shaders
-		GLuint vertex, fragment;
-		GLint success;
-		GLchar infoLog[512];
 		// Vertex Shader
-		vertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(vertex, 1, &vShaderCode, NULL);
-		glCompileShader(vertex);
-		// Print compile errors if any
-		glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-		}
+		vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(vertexShader, 1, &vShaderCode, NULL);
+		glCompileShader(vertexShader);
 		// Fragment Shader
-		fragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragment, 1, &fShaderCode, NULL);
-		glCompileShader(fragment);
-		// Print compile errors if any
-		glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-		if (!success)
-		{
-			glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-		}
+		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+		glCompileShader(fragmentShader);
 		// Shader Program
-		this->ID = glCreateProgram();
-		glAttachShader(this->ID, vertex);
-		glAttachShader(this->ID, fragment);
+		glAttachShader(this->ID, vertexShader);
+		glAttachShader(this->ID, fragmentShader);
+		programcache::prepare(this->ID);
 		glLinkProgram(this->ID);
+	}
+
+	// Verifica o resultado (aqui o driver precisa ter terminado), salva no cache e monta a tabela
+	void finishCompile()
+	{
+		GLint success;
+		GLchar infoLog[512];
+		if (vertexShader)
+		{
+			// Print compile errors if any
+			glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
+				std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+			}
+			glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+			if (!success)
+			{
+				glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
+				std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+			}
+		}
 		// Print linking errors if any
 		glGetProgramiv(this->ID, GL_LINK_STATUS, &success);
 		if (!success)
@@ -91,51 +231,250 @@ public:
 			glGetProgramInfoLog(this->ID, 512, NULL, infoLog);
 			std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 		}
+		else if (!fromCache)
+		{
+			programcache::save(this->ID, cacheKey);
+		}
 		// Delete the shaders as they're linked into our program now and no longer necessery
-		glDeleteShader(vertex);
-		glDeleteShader(fragment);
+		if (vertexShader)
+		{
+			glDeleteShader(vertexShader);
+			glDeleteShader(fragmentShader);
+			vertexShader = fragmentShader = 0;
+		}
+		state = success ? ShaderState::Ready : ShaderState::Failed;
+		// Tabela de uniforms e atributos ativos: depois disso nenhum set* consulta o driver
+		if (success)
+			reflect();
+	}
+
+public:
 
+	// ------------------------------------------------------------------------
+	// Consulta à tabela (busca binária pelo hash, sem strings nem chamadas ao driver)
+	GLint uniformLocation(ShaderName name) const
+	{
+		const ShaderVariable *var = find(uniformTable, name.hash);
+		return var ? var->location : -1;
 	}
-	// Uses the current shader
-	void Use()
+
+	UniformHandle uniform(ShaderName name) const
+	{
+		UniformHandle handle;
+		const ShaderVariable *var = find(uniformTable, name.hash);
+		if (var)
+		{
+			handle.location = var->location;
+			handle.type = var->type;
+		}
+		return handle;
+	}
+
+	GLint attributeLocation(ShaderName name) const
 	{
-		glUseProgram(this->ID);
+		const ShaderVariable *var = find(attributeTable, name.hash);
+		return var ? var->location : -1;
 	}
 
-	void setBool(const std::string& name, bool value) const
+	const std::vector<ShaderVariable> &uniforms() const { return uniformTable; }
+	const std::vector<ShaderVariable> &attributes() const { return attributeTable; }
+
+	// ------------------------------------------------------------------------
+	void setBool(ShaderName name, bool value) const
+	{
+		glUniform1i(uniformLocation(name), (int)value);
+	}
+	// ------------------------------------------------------------------------
+	void setInt(ShaderName name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(this->ID, name.c_str()), (int)value);
+		glUniform1i(uniformLocation(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setInt(const std::string& name, int value) const
+	void setFloat(ShaderName name, float value) const
 	{
-		glUniform1i(glGetUniformLocation(this->ID, name.c_str()), value);
+		glUniform1f(uniformLocation(name), value);
 	}
 	// ------------------------------------------------------------------------
-	void setFloat(const std::string& name, float value) const
+	void setVec2(ShaderName name, float v1, float v2) const
 	{
-		glUniform1f(glGetUniformLocation(this->ID, name.c_str()), value);
+		glUniform2f(uniformLocation(name), v1, v2);
 	}
+
 	// ------------------------------------------------------------------------
-	void setVec2(const std::string& name, float v1, float v2) const
+	void setVec3(ShaderName name, float v1, float v2, float v3) const
+	{
+		glUniform3f(uniformLocation(name), v1, v2, v3);
+	}
+
+	void setVec4(ShaderName name, float v1, float v2, float v3, float v4) const
+	{
+		glUniform4f(uniformLocation(name), v1, v2, v3,v4);
+	}
+
+	void setMat4(ShaderName name, float *v) const
 	{
-		glUniform2f(glGetUniformLocation(this->ID, name.c_str()), v1, v2);
+		glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, v);
 	}
 
 	// ------------------------------------------------------------------------
-	void setVec3(const std::string& name, float v1, float v2, float v3) const
+	// Versões com handle: a localização já está resolvida
+	void setBool(UniformHandle handle, bool value) const
+	{
+		glUniform1i(handle.location, (int)value);
+	}
+
+	void setInt(UniformHandle handle, int value) const
+	{
+		glUniform1i(handle.location, value);
+	}
+
+	void setFloat(UniformHandle handle, float value) const
+	{
+		glUniform1f(handle.location, value);
+	}
+
+	void setVec2(UniformHandle handle, float v1, float v2) const
+	{
+		glUniform2f(handle.location, v1, v2);
+	}
+
+	void setVec3(UniformHandle handle, float v1, float v2, float v3) const
+	{
+		glUniform3f(handle.location, v1, v2, v3);
+	}
+
+	void setVec4(UniformHandle handle, float v1, float v2, float v3, float v4) const
+	{
+		glUniform4f(handle.location, v1, v2, v3, v4);
+	}
+
+	void setMat4(UniformHandle handle, const float *v) const
+	{
+		glUniformMatrix4fv(handle.location, 1, GL_FALSE, v);
+	}
+
+private:
+	std::vector<ShaderVariable> uniformTable;
+	std::vector<ShaderVariable> attributeTable;
+
+	static const ShaderVariable *find(const std::vector<ShaderVariable> &table, uint32_t hash)
+	{
+		auto it = std::lower_bound(table.begin(), table.end(), hash,
+								   [](const ShaderVariable &var, uint32_t h) { return var.hash < h; });
+		if (it == table.end() || it->hash != hash)
+			return nullptr;
+		return &*it;
+	}
+
+	// Adiciona uma variável ativa à tabela. Arrays aparecem como "nome[0]" e são
+	// registrados pelo nome base, com a localização do primeiro elemento.
+	static void addVariable(std::vector<ShaderVariable> &table, std::string name, GLint location, GLenum type, GLint size)
 	{
-		glUniform3f(glGetUniformLocation(this->ID, name.c_str()), v1, v2, v3);
+		if (location < 0 || name.compare(0, 3, "gl_") == 0)
+			return;
+		size_t bracket = name.find("[0]");
+		if (bracket != std::string::npos && bracket + 3 == name.size())
+			name.erase(bracket);
+
+		ShaderVariable var;
+		var.hash = shaderNameHash(name.c_str(), name.size());
+		var.location = location;
+		var.type = type;
+		var.size = size;
+		var.name = name;
+		table.push_back(var);
 	}
 
-	void setVec4(const std::string& name, float v1, float v2, float v3, float v4) const
+	static void sortTable(std::vector<ShaderVariable> &table, const char *kind)
 	{
-		glUniform4f(glGetUniformLocation(this->ID, name.c_str()), v1, v2, v3,v4);
+		std::sort(table.begin(), table.end(), [](const ShaderVariable &a, const ShaderVariable &b) {
+			return a.hash < b.hash;
+		});
+		for (size_t i = 1; i < table.size(); i++)
+			if (table[i].hash == table[i - 1].hash)
+				std::cout << "ERROR::SHADER::" << kind << "_HASH_COLLISION " << table[i - 1].name << " / " << table[i].name << std::endl;
 	}
 
-	void setMat4(const std::string& name, float *v) const
+	// Levanta todos os uniforms e atributos ativos do programa ligado
+	void reflect()
 	{
-		glUniformMatrix4fv(glGetUniformLocation(this->ID, name.c_str()), 1, GL_FALSE, v);
+		uniformTable.clear();
+		attributeTable.clear();
+
+		if (glx::GetProgramInterfaceiv)
+		{
+			const GLenum interfaces[2] = {GL_UNIFORM, GL_PROGRAM_INPUT};
+			for (GLenum iface : interfaces)
+			{
+				GLint count = 0, maxLength = 0;
+				glx::GetProgramInterfaceiv(this->ID, iface, GL_ACTIVE_RESOURCES, &count);
+				glx::GetProgramInterfaceiv(this->ID, iface, GL_MAX_NAME_LENGTH, &maxLength);
+				std::vector<GLchar> name(maxLength + 1);
+				for (GLint i = 0; i < count; i++)
+				{
+					// Uniforms dentro de blocos (UBO) não têm localização própria
+					const GLenum props[4] = {GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX};
+					GLint values[4] = {0, 0, -1, -1};
+					GLsizei numProps = iface == GL_UNIFORM ? 4 : 3;
+					glx::GetProgramResourceiv(this->ID, iface, i, numProps, props, numProps, NULL, values);
+					if (iface == GL_UNIFORM && values[3] != -1)
+						continue;
+					glx::GetProgramResourceName(this->ID, iface, i, (GLsizei)name.size(), NULL, name.data());
+					addVariable(iface == GL_UNIFORM ? uniformTable : attributeTable, name.data(), values[2], values[0], values[1]);
+				}
+			}
+		}
+		else
+		{
+			// Sem ARB_program_interface_query: consultas da OpenGL 2.0, só na ligação
+			GLint count = 0, maxLength = 0;
+			glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
+			glGetProgramiv(this->ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+			std::vector<GLchar> name(maxLength + 1);
+			for (GLint i = 0; i < count; i++)
+			{
+				GLint size;
+				GLenum type;
+				glGetActiveUniform(this->ID, i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+				addVariable(uniformTable, name.data(), glGetUniformLocation(this->ID, name.data()), type, size);
+			}
+
+			glGetProgramiv(this->ID, GL_ACTIVE_ATTRIBUTES, &count);
+			glGetProgramiv(this->ID, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+			name.assign(maxLength + 1, 0);
+			for (GLint i = 0; i < count; i++)
+			{
+				GLint size;
+				GLenum type;
+				glGetActiveAttrib(this->ID, i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+				addVariable(attributeTable, name.data(), glGetAttribLocation(this->ID, name.data()), type, size);
+			}
+		}
+
+		sortTable(uniformTable, "UNIFORM");
+		sortTable(attributeTable, "ATTRIBUTE");
 	}
 };
 
+// Programas compilando em segundo plano. O laço de desenho chama poll() a cada
+// quadro e continua usando os programas substitutos até os verdadeiros ficarem prontos.
+class ShaderQueue
+{
+public:
+	void add(Shader &shader)
+	{
+		pending.push_back(&shader);
+	}
+
+	// Finaliza os programas que terminaram; retorna quantos ainda estão compilando
+	int poll()
+	{
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [](Shader *s) { return s->poll(); }), pending.end());
+		return (int)pending.size();
+	}
+
+	bool empty() const { return pending.empty(); }
+
+private:
+	std::vector<Shader *> pending;
+};
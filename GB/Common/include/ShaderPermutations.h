@@ -0,0 +1,89 @@
+// Variações (permutações) de um mesmo par de shaders, escolhidas por flags de recursos
+//
+// Cada combinação de flags vira um bloco de #define inserido depois do #version,
+// e o shader usa #ifdef para incluir só o código necessário. As variações são
+// compiladas na primeira vez em que são pedidas (em segundo plano, pela ShaderQueue)
+// e, como os defines fazem parte da chave, ficam no cache de binários como qualquer programa.
+
+#pragma once
+
+#include <string>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+#include "Shader.h"
+
+enum ShaderFeature : uint32_t
+{
+	FEATURE_TEXTURED = 1 << 0,			 // cor da textura (sem ela, cor do vértice)
+	FEATURE_QUANTIZED_VERTICES = 1 << 1, // posições em inteiros normalizados + escala/deslocamento
+	FEATURE_INSTANCING = 1 << 2,		 // matriz de modelo por instância (atributos 6 a 9)
+	FEATURE_SHADOWS = 1 << 3,			 // mapa de sombra da luz
+	FEATURE_COUNT = 4
+};
+
+inline const char *shaderFeatureDefine(int bit)
+{
+	static const char *names[FEATURE_COUNT] = {"TEXTURED", "QUANTIZED_VERTICES", "INSTANCING", "SHADOWS"};
+	return names[bit];
+}
+
+class ShaderPermutations
+{
+public:
+	// Sem fila, as variações são compiladas na hora (bloqueando).
+	// prelude: código inserido antes dos defines em todas as variações (ex: VertexLayout::glslHeader())
+	ShaderPermutations(const std::string &vertexPath, const std::string &fragmentPath, ShaderQueue *queue = nullptr,
+					   const std::string &prelude = "")
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), prelude(prelude), queue(queue)
+	{
+	}
+
+	// Bloco de defines de uma combinação de flags
+	static std::string definesFor(uint32_t features)
+	{
+		std::string defines;
+		for (int bit = 0; bit < (int)FEATURE_COUNT; bit++)
+			if (features & (1u << bit))
+				defines += std::string("#define ") + shaderFeatureDefine(bit) + "\n";
+		return defines;
+	}
+
+	// Variação das flags pedidas, criando-a se ainda não existir
+	Shader &get(uint32_t features)
+	{
+		auto it = variants.find(features);
+		if (it != variants.end())
+			return *it->second;
+
+		ShaderCompileMode mode = queue ? ShaderCompileMode::Deferred : ShaderCompileMode::Blocking;
+		std::unique_ptr<Shader> shader(new Shader(vertexPath.c_str(), fragmentPath.c_str(), prelude + definesFor(features), mode));
+		Shader &ref = *shader;
+		variants[features] = std::move(shader);
+		if (queue && !ref.ready() && !ref.failed())
+			queue->add(ref);
+		return ref;
+	}
+
+	// A variação se já estiver pronta; senão dispara a compilação e retorna nullptr
+	const Shader *ready(uint32_t features)
+	{
+		Shader &shader = get(features);
+		return shader.ready() ? &shader : nullptr;
+	}
+
+	// Dispara a compilação de várias variações de uma vez (ex: as usadas pela cena)
+	void prewarm(std::initializer_list<uint32_t> featureSets)
+	{
+		for (uint32_t features : featureSets)
+			get(features);
+	}
+
+	size_t size() const { return variants.size(); }
+
+private:
+	std::string vertexPath, fragmentPath, prelude;
+	ShaderQueue *queue;
+	std::map<uint32_t, std::unique_ptr<Shader>> variants;
+};
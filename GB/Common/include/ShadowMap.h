@@ -0,0 +1,139 @@
+// Mapa de sombra de uma luz direcional
+//
+// A cena é desenhada do ponto de vista da luz (projeção ortográfica) só na profundidade
+// de uma textura GL_DEPTH_COMPONENT24 com comparação ligada. O phong.fs (variação
+// SHADOWS) lê essa textura como sampler2DShadow na unidade 1, com a matriz lightSpace()
+// do LightBlock. Fora da área coberta pela luz a borda vale 1.0 (profundidade máxima),
+// então nada lá fica na sombra.
+//
+// Os desenhos da passada são os mesmos da pré-passada de profundidade (depth.vs): o
+// FrameBlock recebe a view e a projeção da luz antes da passada e a câmera depois.
+//
+//   shadow.look(posiçãoDaLuz, alvo, alcance, distância);
+//   shadow.begin(); ...desenhos de profundidade...; shadow.end(largura, altura);
+//   shadow.bind();
+
+#pragma once
+
+#include <iostream>
+
+//GLAD
+#include <glad/glad.h>
+
+//GLM
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "GLStateCache.h"
+#include "GpuMemory.h"
+
+class ShadowMap
+{
+public:
+	// Unidade de textura do sampler2DShadow (layout(binding = 1) no phong.fs)
+	static const GLuint TEXTURE_UNIT = 1;
+
+	bool create(int size, GpuMemoryRegistry *registry = nullptr)
+	{
+		this->size = size;
+		this->registry = registry;
+
+		glGenTextures(1, &depthTexture);
+		glState.bindTextureUnit(GL_TEXTURE0 + TEXTURE_UNIT, GL_TEXTURE_2D, depthTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		// Filtragem linear com comparação: o hardware faz o PCF de 2x2
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		const GLfloat border[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glState.bindTexture(GL_TEXTURE_2D, 0);
+		glState.activeTexture(GL_TEXTURE0);
+
+		GLint framebuffer = 0;
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		if (!complete)
+		{
+			std::cout << "ERROR::SHADOWMAP::FRAMEBUFFER_INCOMPLETE" << std::endl;
+			destroy();
+			return false;
+		}
+
+		if (registry)
+			registry->trackTexture(depthTexture, (size_t)size * size * 4, GpuSubsystem::Textures, "shadow map");
+		return true;
+	}
+
+	// Luz em "position" olhando para "target"; a projeção cobre um quadrado de lado
+	// 2 * extent em volta do alvo, até "range" unidades da luz
+	void look(const glm::vec3 &position, const glm::vec3 &target, float extent, float range)
+	{
+		glm::vec3 dir = glm::normalize(target - position);
+		glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		lightView = glm::lookAt(position, target, up);
+		lightProjection = glm::ortho(-extent, extent, -extent, extent, 0.1f, range);
+	}
+
+	const glm::mat4 &view() const { return lightView; }
+	const glm::mat4 &projection() const { return lightProjection; }
+	// Do mundo para o espaço de recorte da luz (LightBlock::lightSpace)
+	glm::mat4 lightSpace() const { return lightProjection * lightView; }
+
+	// Passa a desenhar na profundidade do mapa (guarda o framebuffer atual para o end())
+	void begin()
+	{
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glViewport(0, 0, size, size);
+		glState.depthMask(GL_TRUE);
+		glState.depthFunc(GL_LESS);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+
+	// Volta para o framebuffer de antes do begin() (a janela)
+	void end(int width, int height) const
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+		glViewport(0, 0, width, height);
+	}
+
+	// Vincula o mapa na unidade do sampler e volta para a unidade 0 (texturas dos objetos)
+	void bind() const
+	{
+		glState.bindTextureUnit(GL_TEXTURE0 + TEXTURE_UNIT, GL_TEXTURE_2D, depthTexture);
+		glState.activeTexture(GL_TEXTURE0);
+	}
+
+	bool isCreated() const { return fbo != 0; }
+
+	void destroy()
+	{
+		if (depthTexture)
+		{
+			if (registry)
+				registry->untrack(GpuResourceType::Texture, depthTexture);
+			glState.forgetTexture(depthTexture);
+			glDeleteTextures(1, &depthTexture);
+		}
+		if (fbo)
+			glDeleteFramebuffers(1, &fbo);
+		depthTexture = fbo = 0;
+	}
+
+private:
+	int size = 0;
+	GLuint depthTexture = 0, fbo = 0;
+	GLint previousFramebuffer = 0;
+	glm::mat4 lightView = glm::mat4(1.0f), lightProjection = glm::mat4(1.0f);
+	GpuMemoryRegistry *registry = nullptr;
+};
@@ -0,0 +1,597 @@
+// Streaming de mipmaps de textura guiado pela distância, com orçamento de memória de vídeo
+//
+// Na carga apenas os níveis grossos (menores) de cada textura ficam residentes.
+// Os níveis mais finos são decodificados em threads de trabalho conforme o tamanho
+// projetado do objeto na tela e enviados para a GPU na thread da OpenGL.
+// Quando o orçamento é ultrapassado, os níveis mais finos das texturas menos usadas
+// recentemente (LRU) são descartados.
+//
+// As threads escrevem os níveis direto no UploadRing (buffer de pixels mapeado), e o
+// envio para a GPU não passa por cópia na memória do cliente. A decodificação usa o
+// ImageDecoder (stb_image ou libjpeg-turbo). Estas texturas continuam com armazenamento
+// mutável (glTexImage2D) porque cada nível precisa poder ser descartado sozinho.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "ImageDecoder.h"
+#include "UploadRing.h"
+#include "GpuMemory.h"
+
+// Um nível da cadeia de mipmaps (sempre RGBA8)
+struct MipLevel
+{
+	int width, height;
+	std::vector<unsigned char> pixels;
+};
+
+// Quantidade de níveis de mipmap de uma imagem w x h (até 1x1)
+inline int mipLevelCount(int width, int height)
+{
+	int levels = 1;
+	int size = std::max(width, height);
+	while (size > 1)
+	{
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+// Bytes ocupados por um nível RGBA8
+inline size_t mipLevelBytes(int width, int height, int level)
+{
+	size_t w = std::max(1, width >> level);
+	size_t h = std::max(1, height >> level);
+	return w * h * 4;
+}
+
+// Reduz uma imagem RGBA8 pela metade com filtro caixa 2x2, escrevendo em dst
+// (max(1, w/2) x max(1, h/2) texels)
+inline void downsampleInto(const unsigned char *src, int srcWidth, int srcHeight, unsigned char *dst)
+{
+	int dstWidth = std::max(1, srcWidth / 2);
+	int dstHeight = std::max(1, srcHeight / 2);
+
+	for (int y = 0; y < dstHeight; y++)
+	{
+		int y0 = std::min(y * 2, srcHeight - 1);
+		int y1 = std::min(y * 2 + 1, srcHeight - 1);
+		for (int x = 0; x < dstWidth; x++)
+		{
+			int x0 = std::min(x * 2, srcWidth - 1);
+			int x1 = std::min(x * 2 + 1, srcWidth - 1);
+			for (int c = 0; c < 4; c++)
+			{
+				int sum = src[((size_t)y0 * srcWidth + x0) * 4 + c] +
+						  src[((size_t)y0 * srcWidth + x1) * 4 + c] +
+						  src[((size_t)y1 * srcWidth + x0) * 4 + c] +
+						  src[((size_t)y1 * srcWidth + x1) * 4 + c];
+				dst[((size_t)y * dstWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+			}
+		}
+	}
+}
+
+// Reduz um nível pela metade com filtro caixa 2x2 (RGBA8)
+inline MipLevel downsampleMip(const MipLevel &src)
+{
+	MipLevel dst;
+	dst.width = std::max(1, src.width / 2);
+	dst.height = std::max(1, src.height / 2);
+	dst.pixels.resize((size_t)dst.width * dst.height * 4);
+	downsampleInto(src.pixels.data(), src.width, src.height, dst.pixels.data());
+	return dst;
+}
+
+// Gera a cadeia de mipmaps completa na CPU a partir da imagem RGBA8 decodificada
+inline std::vector<MipLevel> generateMipChain(const unsigned char *data, int width, int height)
+{
+	std::vector<MipLevel> chain;
+	MipLevel base;
+	base.width = width;
+	base.height = height;
+	base.pixels.assign(data, data + (size_t)width * height * 4);
+	chain.push_back(std::move(base));
+
+	int levels = mipLevelCount(width, height);
+	for (int i = 1; i < levels; i++)
+		chain.push_back(downsampleMip(chain.back()));
+	return chain;
+}
+
+// Tamanho aproximado (em pixels) que um objeto de raio "radius" ocupa na tela
+// quando está a "distance" da câmera
+inline float projectedSize(float radius, float distance, float fovY, int viewportHeight)
+{
+	distance = std::max(distance, 0.001f);
+	return (radius / (distance * std::tan(fovY * 0.5f))) * viewportHeight;
+}
+
+class TextureStreamer
+{
+public:
+	// Limite de lado (em pixels) dos níveis carregados já na inicialização
+	int coarseSize = 128;
+	// Tamanho do anel de upload compartilhado pelas threads (bytes)
+	size_t ringSize = 32u * 1024u * 1024u;
+	// Registro onde as texturas e o anel são contabilizados (opcional)
+	GpuMemoryRegistry *registry = nullptr;
+	// Orçamento de memória de vídeo para as texturas gerenciadas (bytes). Com um registro,
+	// o orçamento geral dele também vale: as texturas menos usadas devolvem níveis finos.
+	size_t budget = 256u * 1024u * 1024u;
+
+	TextureStreamer(int numWorkers = 0)
+	{
+		if (numWorkers <= 0)
+			numWorkers = std::max(1, std::min(4, (int)std::thread::hardware_concurrency() - 1));
+		for (int i = 0; i < numWorkers; i++)
+			workers.emplace_back(&TextureStreamer::workerLoop, this);
+	}
+
+	~TextureStreamer()
+	{
+		shutdown();
+	}
+
+	// Encerra as threads de trabalho (deve ser chamado antes de destruir o contexto)
+	void shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			if (stopping)
+				return;
+			stopping = true;
+		}
+		queueCond.notify_all();
+		ring.shutdown();
+		for (std::thread &t : workers)
+			t.join();
+		workers.clear();
+		if (registry && ring.isPersistent())
+			registry->untrack(GpuResourceType::Buffer, ring.buffer());
+		ring.destroy();
+	}
+
+	// Registra uma textura: cria o objeto de textura com um nível provisório 1x1
+	// e agenda a decodificação dos níveis grossos. Retorna o identificador da textura.
+	GLuint load(const std::string &filePath, int &width, int &height)
+	{
+		uploadRing();
+
+		if (!imageInfo(filePath, width, height))
+		{
+			std::cout << "Failed to load texture " << filePath << std::endl;
+			width = height = 0;
+			return 0;
+		}
+
+		StreamedTexture tex;
+		tex.path = filePath;
+		tex.width = width;
+		tex.height = height;
+		tex.levels = mipLevelCount(width, height);
+		tex.coarseLevel = tex.levels - 1;
+		while (tex.coarseLevel > 0 &&
+			   std::max(width >> (tex.coarseLevel - 1), height >> (tex.coarseLevel - 1)) <= coarseSize)
+			tex.coarseLevel--;
+		tex.residentBase = tex.levels; // nenhum nível real residente ainda
+		tex.desiredLevel = tex.coarseLevel;
+
+		glGenTextures(1, &tex.id);
+		glState.bindTexture(GL_TEXTURE_2D, tex.id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// Nível provisório: um texel cinza no menor nível, até os níveis grossos chegarem
+		const unsigned char gray[4] = {128, 128, 128, 255};
+		glTexImage2D(GL_TEXTURE_2D, tex.levels - 1, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tex.levels - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex.levels - 1);
+		glState.bindTexture(GL_TEXTURE_2D, 0);
+
+		tex.lastUsedFrame = frame;
+		textures[tex.id] = tex;
+		// Sobre o orçamento do registro, a textura devolve os níveis mais finos
+		if (registry)
+			registry->trackTexture(tex.id, 0, GpuSubsystem::TextureStreaming, filePath,
+								   [this, id = tex.id](size_t excess) { shrink(id, excess); });
+		requestLevels(textures[tex.id], tex.coarseLevel);
+
+		return tex.id;
+	}
+
+	// Informa o tamanho projetado (em pixels) de um objeto que usa a textura neste quadro.
+	// Pode ser chamado várias vezes por quadro; vale o maior tamanho pedido.
+	void requestResolution(GLuint texID, float screenPixels)
+	{
+		auto it = textures.find(texID);
+		if (it == textures.end())
+			return;
+		StreamedTexture &tex = it->second;
+
+		// Nível cujo lado é o mais próximo do tamanho projetado
+		float ratio = (float)std::max(tex.width, tex.height) / std::max(screenPixels, 1.0f);
+		int level = (int)std::floor(std::log2(std::max(ratio, 1.0f)));
+		level = std::min(level, tex.coarseLevel);
+
+		if (tex.lastUsedFrame != frame)
+			tex.desiredLevel = level;
+		else
+			tex.desiredLevel = std::min(tex.desiredLevel, level);
+		tex.lastUsedFrame = frame;
+		if (registry)
+			registry->touch(GpuResourceType::Texture, texID);
+	}
+
+	// Executado uma vez por quadro na thread da OpenGL: envia os níveis prontos,
+	// agenda novos pedidos e aplica o orçamento
+	void update()
+	{
+		ring.retire();
+		uploadFinished();
+
+		// Memória que pode ser recuperada das texturas que não foram pedidas neste quadro
+		size_t evictable = 0;
+		for (auto &entry : textures)
+		{
+			const StreamedTexture &tex = entry.second;
+			if (tex.lastUsedFrame != frame)
+				for (int l = tex.residentBase; l < tex.coarseLevel; l++)
+					evictable += mipLevelBytes(tex.width, tex.height, l);
+		}
+
+		for (auto &entry : textures)
+		{
+			StreamedTexture &tex = entry.second;
+			if (tex.lastUsedFrame != frame || tex.desiredLevel >= tex.residentBase)
+				continue;
+
+			// Só pede os níveis que cabem no orçamento, para não carregar e descartar em seguida
+			int level = tex.desiredLevel;
+			while (level < tex.residentBase && level < tex.coarseLevel)
+			{
+				size_t extra = 0;
+				for (int l = level; l < std::min(tex.residentBase, tex.levels); l++)
+					extra += mipLevelBytes(tex.width, tex.height, l);
+				if (residentBytes + extra <= budget + evictable)
+					break;
+				level++;
+			}
+			requestLevels(tex, level);
+		}
+
+		enforceBudget();
+		frame++;
+	}
+
+	// Libera a textura e a contabilização de memória
+	void release(GLuint texID)
+	{
+		auto it = textures.find(texID);
+		if (it == textures.end())
+			return;
+		StreamedTexture &tex = it->second;
+		residentBytes -= textureBytes(tex);
+		if (registry)
+			registry->untrack(GpuResourceType::Texture, tex.id);
+		glState.forgetTexture(tex.id);
+		glDeleteTextures(1, &tex.id);
+		textures.erase(it);
+	}
+
+	size_t getResidentBytes() const { return residentBytes; }
+
+	// Anel de upload, para outros envios de textura feitos na thread da OpenGL
+	UploadRing &uploadRing()
+	{
+		if (!ring.isCreated())
+		{
+			ring.create(ringSize);
+			if (registry && ring.isPersistent())
+				registry->trackBuffer(ring.buffer(), GL_PIXEL_UNPACK_BUFFER, ring.size(), GpuSubsystem::Upload, "texture upload ring");
+		}
+		return ring;
+	}
+
+	int getResidentLevel(GLuint texID) const
+	{
+		auto it = textures.find(texID);
+		return it == textures.end() ? -1 : it->second.residentBase;
+	}
+
+private:
+	struct StreamedTexture
+	{
+		GLuint id = 0;
+		std::string path;
+		int width = 0, height = 0;
+		int levels = 1;
+		int coarseLevel = 0;	 // níveis >= coarseLevel nunca são descartados
+		int residentBase = 0;	 // nível mais fino residente na GPU
+		int desiredLevel = 0;	 // nível mais fino pedido neste quadro
+		int pendingLevel = -1;	 // nível mais fino já pedido às threads (-1 = nenhum)
+		unsigned long lastUsedFrame = 0;
+	};
+
+	// Pedido de decodificação: produzir os níveis [firstLevel, lastLevel] da textura
+	struct StreamRequest
+	{
+		GLuint texID;
+		std::string path;
+		int firstLevel, lastLevel;
+	};
+
+	// Níveis prontos: ficam na fatia do anel ou, se não couberem nele, em "pixels"
+	struct StreamResult
+	{
+		GLuint texID;
+		int firstLevel;
+		int numLevels = 0;
+		std::vector<size_t> offsets; // início de cada nível dentro dos dados
+		UploadSlice slice;
+		bool inRing = false;
+		std::vector<unsigned char> pixels;
+	};
+
+	std::unordered_map<GLuint, StreamedTexture> textures;
+	size_t residentBytes = 0;
+	unsigned long frame = 0;
+
+	UploadRing ring;
+	// Threads das faixas de JPEG, divididas entre as threads de trabalho
+	ImageDecoderPool decoderPool;
+	std::vector<std::thread> workers;
+	std::deque<StreamRequest> requests;
+	std::vector<StreamResult> results;
+	std::mutex queueMutex, resultMutex;
+	std::condition_variable queueCond;
+	bool stopping = false;
+
+	// Bytes dos níveis residentes de uma textura
+	static size_t textureBytes(const StreamedTexture &tex)
+	{
+		size_t bytes = 0;
+		for (int l = tex.residentBase; l < tex.levels; l++)
+			bytes += mipLevelBytes(tex.width, tex.height, l);
+		return bytes;
+	}
+
+	void requestLevels(StreamedTexture &tex, int level)
+	{
+		// Já residente ou já pedido
+		if (level >= tex.residentBase || (tex.pendingLevel >= 0 && level >= tex.pendingLevel))
+			return;
+
+		StreamRequest req;
+		req.texID = tex.id;
+		req.path = tex.path;
+		req.firstLevel = level;
+		req.lastLevel = tex.residentBase - 1;
+		if (tex.pendingLevel >= 0)
+			req.lastLevel = std::min(req.lastLevel, tex.pendingLevel - 1);
+		tex.pendingLevel = level;
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			requests.push_back(req);
+		}
+		queueCond.notify_one();
+	}
+
+	void workerLoop()
+	{
+		for (;;)
+		{
+			StreamRequest req;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				queueCond.wait(lock, [this] { return stopping || !requests.empty(); });
+				if (stopping)
+					return;
+				req = requests.front();
+				requests.pop_front();
+			}
+
+			StreamResult res;
+			res.texID = req.texID;
+			res.firstLevel = req.firstLevel;
+
+			// A imagem é decodificada direto no destino quando o nível 0 faz parte do pedido;
+			// senão vai para um buffer temporário de onde os níveis pedidos são reduzidos
+			int width, height;
+			unsigned char *dst = nullptr;
+			std::vector<unsigned char> decoded;
+			bool ok = decodeImageRGBA(req.path, width, height, [&](int w, int h) -> unsigned char * {
+				size_t total = 0;
+				for (int l = req.firstLevel; l <= req.lastLevel; l++)
+				{
+					res.offsets.push_back(total);
+					total += mipLevelBytes(w, h, l);
+				}
+				res.numLevels = req.lastLevel - req.firstLevel + 1;
+
+				res.inRing = ring.allocate(total, res.slice);
+				if (res.inRing)
+				{
+					dst = res.slice.ptr;
+				}
+				else
+				{
+					res.pixels.resize(total);
+					dst = res.pixels.data();
+				}
+				if (req.firstLevel == 0)
+					return dst;
+				decoded.resize((size_t)w * h * 4);
+				return decoded.data();
+			}, &decoderPool);
+			if (ok)
+			{
+				// Reduz até o último nível pedido. Os níveis da faixa são reduzidos direto no
+				// destino; só os níveis acima do primeiro pedido passam pelos buffers temporários
+				const unsigned char *current = req.firstLevel == 0 ? dst : decoded.data();
+				std::vector<unsigned char> scratch[2];
+				int w = width, h = height;
+				for (int l = 0; l < req.lastLevel; l++)
+				{
+					unsigned char *next;
+					if (l + 1 >= req.firstLevel)
+					{
+						next = dst + res.offsets[l + 1 - req.firstLevel];
+					}
+					else
+					{
+						scratch[l & 1].resize((size_t)std::max(1, w / 2) * std::max(1, h / 2) * 4);
+						next = scratch[l & 1].data();
+					}
+					downsampleInto(current, w, h, next);
+					current = next;
+					w = std::max(1, w / 2);
+					h = std::max(1, h / 2);
+				}
+			}
+			else
+			{
+				std::cout << "Failed to load texture " << req.path << std::endl;
+				if (res.inRing)
+					ring.cancel(res.slice);
+				res.inRing = false;
+				res.numLevels = 0;
+			}
+
+			std::lock_guard<std::mutex> lock(resultMutex);
+			results.push_back(std::move(res));
+		}
+	}
+
+	void uploadFinished()
+	{
+		std::vector<StreamResult> ready;
+		{
+			std::lock_guard<std::mutex> lock(resultMutex);
+			ready.swap(results);
+		}
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		for (StreamResult &res : ready)
+		{
+			auto it = textures.find(res.texID);
+			bool uploaded = false;
+			if (it != textures.end())
+			{
+				StreamedTexture &tex = it->second;
+				if (res.firstLevel <= tex.pendingLevel)
+					tex.pendingLevel = -1;
+
+				int lastLevel = res.firstLevel + res.numLevels - 1;
+				// Só é possível baixar o nível base se a faixa recebida encosta na residente
+				if (res.numLevels > 0 && lastLevel >= tex.residentBase - 1)
+				{
+					glState.bindTexture(GL_TEXTURE_2D, tex.id);
+					if (res.inRing)
+						ring.bind();
+					for (int i = 0; i < res.numLevels; i++)
+					{
+						int level = res.firstLevel + i;
+						bool wasResident = level >= tex.residentBase;
+						const void *pixels = res.inRing ? ring.source(res.slice, res.offsets[i])
+														: res.pixels.data() + res.offsets[i];
+						glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, std::max(1, tex.width >> level), std::max(1, tex.height >> level),
+									 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+						if (!wasResident)
+							residentBytes += mipLevelBytes(tex.width, tex.height, level);
+					}
+					if (res.inRing)
+					{
+						ring.unbind();
+						ring.submit(res.slice);
+						uploaded = true;
+					}
+					tex.residentBase = std::min(tex.residentBase, res.firstLevel);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, tex.residentBase);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex.levels - 1);
+					if (registry)
+						registry->resize(GpuResourceType::Texture, tex.id, textureBytes(tex));
+				}
+			}
+			if (res.inRing && !uploaded)
+				ring.cancel(res.slice);
+		}
+		glState.bindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// Descarta o nível mais fino de uma textura, redefinindo-o com tamanho zero
+	void evictLevel(StreamedTexture &tex)
+	{
+		int level = tex.residentBase;
+		glState.bindTexture(GL_TEXTURE_2D, tex.id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glState.bindTexture(GL_TEXTURE_2D, 0);
+		residentBytes -= mipLevelBytes(tex.width, tex.height, level);
+		tex.residentBase = level + 1;
+		if (registry)
+			registry->resize(GpuResourceType::Texture, tex.id, textureBytes(tex));
+	}
+
+	// Chamado pelo registro: descarta níveis finos até liberar "excess" bytes (ou chegar aos grossos)
+	void shrink(GLuint texID, size_t excess)
+	{
+		auto it = textures.find(texID);
+		if (it == textures.end())
+			return;
+		StreamedTexture &tex = it->second;
+		size_t freed = 0;
+		while (freed < excess && tex.residentBase < tex.coarseLevel)
+		{
+			freed += mipLevelBytes(tex.width, tex.height, tex.residentBase);
+			evictLevel(tex);
+		}
+	}
+
+	void enforceBudget()
+	{
+		// Primeiro descarta os níveis que ninguém pediu neste quadro
+		for (auto &entry : textures)
+		{
+			StreamedTexture &tex = entry.second;
+			while (residentBytes > budget && tex.residentBase < tex.coarseLevel &&
+				   (tex.lastUsedFrame != frame || tex.residentBase < tex.desiredLevel))
+				evictLevel(tex);
+		}
+		if (residentBytes <= budget)
+			return;
+
+		// Depois segue a ordem LRU, da textura usada há mais tempo para a mais recente
+		std::vector<StreamedTexture *> lru;
+		for (auto &entry : textures)
+			if (entry.second.residentBase < entry.second.coarseLevel)
+				lru.push_back(&entry.second);
+		std::sort(lru.begin(), lru.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+			return a->lastUsedFrame < b->lastUsedFrame;
+		});
+		for (StreamedTexture *tex : lru)
+		{
+			while (residentBytes > budget && tex->residentBase < tex->coarseLevel)
+				evictLevel(*tex);
+			if (residentBytes <= budget)
+				break;
+		}
+	}
+};
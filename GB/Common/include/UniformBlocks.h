@@ -0,0 +1,129 @@
+// Blocos de uniforms compartilhados (std140) entre todos os shaders
+//
+// Cada bloco tem um ponto de ligação fixo, declarado também no GLSL com
+// layout(std140, binding = N). Os buffers são ligados uma vez e qualquer programa
+// que declare o bloco enxerga os mesmos dados, sem glUniform* por programa.
+// As structs abaixo seguem as regras do std140: vec3 ocupa 16 bytes, por isso o
+// preenchimento explícito depois de cada vec3.
+
+#pragma once
+
+#include <string>
+#include <cstring>
+
+//GLAD
+#include <glad/glad.h>
+
+//GLM
+#include <glm/glm.hpp>
+
+#include "GpuMemory.h"
+#include "FrameRing.h"
+
+// Pontos de ligação (GL_UNIFORM_BUFFER)
+enum UniformBlockBinding
+{
+	FRAME_BLOCK_BINDING = 0,
+	LIGHT_BLOCK_BINDING = 1
+};
+
+// Dados por quadro: câmera
+struct FrameBlock
+{
+	glm::mat4 view = glm::mat4(1.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::vec3 cameraPos = glm::vec3(0.0f);
+	float pad0 = 0.0f;
+};
+
+// Fonte de luz
+struct LightBlock
+{
+	glm::vec3 lightPos = glm::vec3(0.0f);
+	float pad0 = 0.0f;
+	glm::vec3 lightColor = glm::vec3(1.0f);
+	float pad1 = 0.0f;
+	glm::mat4 lightSpace = glm::mat4(1.0f); // projeção * view da luz (variação SHADOWS)
+};
+
+static_assert(sizeof(FrameBlock) == 144, "FrameBlock fora do layout std140");
+static_assert(sizeof(LightBlock) == 96, "LightBlock fora do layout std140");
+
+// Buffer de um bloco: "data" é a cópia na CPU, enviada inteira por upload()
+template <typename T>
+class UniformBuffer
+{
+public:
+	T data;
+
+	void create(GLuint binding, GpuMemoryRegistry *registry = nullptr, const std::string &name = "uniform block")
+	{
+		this->binding = binding;
+		this->registry = registry;
+		glGenBuffers(1, &ubo);
+		glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+		glState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+		bind();
+		if (registry)
+			registry->trackBuffer(ubo, GL_UNIFORM_BUFFER, sizeof(T), GpuSubsystem::Uniforms, name);
+	}
+
+	// Liga o buffer ao ponto do bloco (já feito no create)
+	void bind() const
+	{
+		glState.bindBufferBase(GL_UNIFORM_BUFFER, binding, ubo);
+	}
+
+	// Envia o bloco inteiro com um único glBufferSubData
+	void upload() const
+	{
+		glState.bindBuffer(GL_UNIFORM_BUFFER, ubo);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+		glState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+
+	// Escreve o bloco na região do quadro do anel e liga essa faixa ao ponto do bloco,
+	// sem glBufferSubData. Se o anel estiver cheio, usa o buffer próprio.
+	void upload(FrameRing &ring)
+	{
+		if (!uniformAlignment)
+		{
+			GLint alignment = 256;
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			uniformAlignment = alignment > 0 ? alignment : 256;
+		}
+		FrameAllocation slice = ring.allocate(sizeof(T), uniformAlignment);
+		if (!slice.valid())
+		{
+			upload();
+			bind();
+			return;
+		}
+		memcpy(slice.ptr, &data, sizeof(T));
+		ring.flush();
+		glState.bindBufferRange(GL_UNIFORM_BUFFER, binding, ring.buffer(), slice.offset, sizeof(T));
+	}
+
+	void destroy()
+	{
+		if (!ubo)
+			return;
+		if (registry)
+			registry->release(GpuResourceType::Buffer, ubo);
+		else
+		{
+			glState.forgetBuffer(ubo);
+			glDeleteBuffers(1, &ubo);
+		}
+		ubo = 0;
+	}
+
+	GLuint buffer() const { return ubo; }
+
+private:
+	GLuint ubo = 0;
+	GLuint binding = 0;
+	size_t uniformAlignment = 0;
+	GpuMemoryRegistry *registry = nullptr;
+};
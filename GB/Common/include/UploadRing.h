@@ -0,0 +1,262 @@
+// Anel de upload de pixels com buffer persistentemente mapeado (GL_PIXEL_UNPACK_BUFFER)
+//
+// As threads de decodificação reservam uma fatia do anel e escrevem os texels
+// direto na memória mapeada. A thread da OpenGL envia a fatia com glTexSubImage2D
+// (ou glTexImage2D) usando o deslocamento no buffer e coloca um fence depois.
+// A fatia só volta a ficar livre quando o fence sinaliza que a GPU terminou de ler.
+//
+// Sem glBufferStorage o anel usa memória comum da CPU e o envio volta a ser
+// feito a partir da memória do cliente.
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+//GLAD
+#include <glad/glad.h>
+
+#include "GLExtensoes.h"
+#include "GLStateCache.h"
+
+// Região reservada no anel
+struct UploadSlice
+{
+	size_t offset = 0;
+	size_t size = 0;
+	unsigned char *ptr = nullptr; // onde escrever os dados
+	unsigned long id = 0;
+};
+
+class UploadRing
+{
+public:
+	// Cria o buffer (thread da OpenGL)
+	void create(size_t size)
+	{
+		capacity = size;
+		head = 0;
+		if (glx::BufferStorage)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glGenBuffers(1, &pbo);
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			glx::BufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, flags);
+			mapped = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		if (!mapped)
+		{
+			if (pbo)
+			{
+				glState.forgetBuffer(pbo);
+				glDeleteBuffers(1, &pbo);
+			}
+			pbo = 0;
+			fallback.resize(size);
+			mapped = fallback.data();
+		}
+	}
+
+	// Libera o buffer e os fences pendentes (thread da OpenGL, depois de parar as threads de trabalho)
+	void destroy()
+	{
+		shutdown();
+		for (Entry &e : entries)
+			if (e.fence)
+				glDeleteSync(e.fence);
+		entries.clear();
+		if (pbo)
+		{
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glState.forgetBuffer(pbo);
+			glDeleteBuffers(1, &pbo);
+			pbo = 0;
+		}
+		fallback.clear();
+		mapped = nullptr;
+		capacity = 0;
+	}
+
+	// Acorda as threads que esperam espaço; as reservas seguintes falham
+	void shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		spaceFreed.notify_all();
+	}
+
+	bool isCreated() const { return capacity != 0; }
+	bool isPersistent() const { return pbo != 0; }
+	GLuint buffer() const { return pbo; }
+	size_t size() const { return capacity; }
+
+	// Reserva sem bloquear. Pode ser chamado de qualquer thread.
+	bool tryAllocate(size_t size, UploadSlice &slice)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return allocateLocked(size, slice);
+	}
+
+	// Reserva esperando a GPU liberar espaço (somente threads de trabalho: quem libera
+	// espaço é retire(), chamado pela thread da OpenGL). Falha se a fatia não cabe no anel.
+	bool allocate(size_t size, UploadSlice &slice)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (alignSize(size) > capacity)
+			return false;
+		spaceFreed.wait(lock, [&] { return stopping || allocateLocked(size, slice); });
+		return !stopping;
+	}
+
+	// Ponteiro a passar para glTexImage2D/glTexSubImage2D com o anel vinculado
+	const void *source(const UploadSlice &slice, size_t offset = 0) const
+	{
+		if (pbo)
+			return (const void *)(slice.offset + offset);
+		return slice.ptr + offset;
+	}
+
+	// Vincula/desvincula o buffer como origem dos pixels (thread da OpenGL)
+	void bind() const
+	{
+		if (pbo)
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+	}
+	void unbind() const
+	{
+		if (pbo)
+			glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	// Marca a fatia como enviada: coloca o fence depois dos comandos que a leem (thread da OpenGL)
+	void submit(const UploadSlice &slice)
+	{
+		GLsync fence = pbo ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Entry &e : entries)
+			if (e.id == slice.id)
+			{
+				e.fence = fence;
+				e.submitted = true;
+				return;
+			}
+		if (fence)
+			glDeleteSync(fence);
+	}
+
+	// Devolve uma fatia que não será enviada (ex: falha na decodificação)
+	void cancel(const UploadSlice &slice)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (Entry &e : entries)
+			if (e.id == slice.id)
+				e.submitted = true;
+	}
+
+	// Libera as fatias cujo fence já sinalizou, na ordem de reserva (thread da OpenGL)
+	void retire()
+	{
+		bool freed = false;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (!entries.empty() && entries.front().submitted)
+			{
+				Entry &e = entries.front();
+				if (e.fence)
+				{
+					GLenum status = glClientWaitSync(e.fence, 0, 0);
+					if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+						break;
+					glDeleteSync(e.fence);
+				}
+				entries.pop_front();
+				freed = true;
+			}
+		}
+		if (freed)
+			spaceFreed.notify_all();
+	}
+
+private:
+	struct Entry
+	{
+		unsigned long id;
+		size_t offset, size;
+		GLsync fence = 0;
+		bool submitted = false;
+	};
+
+	GLuint pbo = 0;
+	unsigned char *mapped = nullptr;
+	std::vector<unsigned char> fallback;
+	size_t capacity = 0;
+	size_t head = 0;
+	unsigned long nextID = 1;
+	std::deque<Entry> entries;
+	std::mutex mutex;
+	std::condition_variable spaceFreed;
+	bool stopping = false;
+
+	// Alinhamento das fatias (múltiplo do tamanho de qualquer texel)
+	static size_t alignSize(size_t size)
+	{
+		return (size + 255) & ~(size_t)255;
+	}
+
+	bool allocateLocked(size_t size, UploadSlice &slice)
+	{
+		if (stopping)
+			return false;
+		size = alignSize(size);
+		if (size > capacity)
+			return false;
+
+		size_t offset;
+		if (entries.empty())
+		{
+			offset = 0;
+		}
+		else
+		{
+			size_t tail = entries.front().offset;
+			if (head == tail)
+				return false; // cheio
+			if (head > tail)
+			{
+				// Livre: [head, capacity) e [0, tail)
+				if (capacity - head >= size)
+					offset = head;
+				else if (tail >= size)
+					offset = 0;
+				else
+					return false;
+			}
+			else
+			{
+				if (tail - head < size)
+					return false;
+				offset = head;
+			}
+		}
+
+		Entry e;
+		e.id = nextID++;
+		e.offset = offset;
+		e.size = size;
+		entries.push_back(e);
+		head = offset + size;
+
+		slice.offset = offset;
+		slice.size = size;
+		slice.ptr = mapped + offset;
+		slice.id = e.id;
+		return true;
+	}
+};
@@ -0,0 +1,188 @@
+// Formatos de vértice descritos em tempo de compilação
+//
+// Um VertexLayout<Attr...> lista os atributos intercalados de um buffer de vértices.
+// Stride, deslocamentos e tipos GL são calculados pelo compilador, e o mesmo tipo gera
+// a configuração do VAO (setup()) e as declarações GLSL correspondentes (glslHeader()),
+// então o código C++ e o shader não têm como discordar do formato.
+//
+// Cada atributo define o tipo de armazenamento: Position<GLshort, 3, true> é uma posição
+// em inteiros normalizados, que no shader continua sendo um vec3.
+//
+//   using ObjVertex = VertexLayout<Position<>, Color<>, TexCoord<>, Normal<>>;
+//   ObjVertex::setup();              // com o VAO e o VBO vinculados
+//   Shader s(vs, fs, ObjVertex::glslDefine());
+//
+// Os defines vão para os dois estágios, então as declarações são entregues numa macro
+// de uma linha (VERTEX_INPUTS) que o vertex shader expande onde declararia os atributos.
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <utility>
+#include <type_traits>
+
+//GLAD
+#include <glad/glad.h>
+
+// Tipo GL de cada tipo C++
+template <typename T>
+struct GLTypeOf;
+template <>
+struct GLTypeOf<GLfloat> { static constexpr GLenum value = GL_FLOAT; };
+template <>
+struct GLTypeOf<GLbyte> { static constexpr GLenum value = GL_BYTE; };
+template <>
+struct GLTypeOf<GLubyte> { static constexpr GLenum value = GL_UNSIGNED_BYTE; };
+template <>
+struct GLTypeOf<GLshort> { static constexpr GLenum value = GL_SHORT; };
+template <>
+struct GLTypeOf<GLushort> { static constexpr GLenum value = GL_UNSIGNED_SHORT; };
+template <>
+struct GLTypeOf<GLint> { static constexpr GLenum value = GL_INT; };
+template <>
+struct GLTypeOf<GLuint> { static constexpr GLenum value = GL_UNSIGNED_INT; };
+
+// Atributo: localização no shader, tipo armazenado e número de componentes.
+// Inteiros não normalizados chegam ao shader como int/ivec (glVertexAttribIPointer).
+template <GLuint Location, typename T, int Components, bool Normalized = false>
+struct VertexAttr
+{
+	static_assert(Components >= 1 && Components <= 4, "atributo com 1 a 4 componentes");
+
+	static constexpr bool padding = false;
+	static constexpr GLuint location = Location;
+	static constexpr GLint components = Components;
+	static constexpr GLenum glType = GLTypeOf<T>::value;
+	static constexpr GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+	static constexpr GLsizei size = sizeof(T) * Components;
+	static constexpr bool integer = std::is_integral<T>::value && !Normalized;
+	static constexpr bool isUnsigned = std::is_unsigned<T>::value;
+
+	// Tipo GLSL (float, vec3, ivec2, uint...)
+	static std::string glslType()
+	{
+		if (Components == 1)
+			return integer ? (isUnsigned ? "uint" : "int") : "float";
+		std::string prefix = integer ? (isUnsigned ? "uvec" : "ivec") : "vec";
+		return prefix + std::to_string(Components);
+	}
+};
+
+// Bytes vazios, para manter os atributos seguintes alinhados em 4 bytes
+template <int Bytes>
+struct VertexPad
+{
+	static constexpr bool padding = true;
+	static constexpr GLsizei size = Bytes;
+};
+
+// Atributos usados pelos shaders do projeto (localizações fixas no GLSL)
+template <typename T = GLfloat, int N = 3, bool Normalized = false>
+struct Position : VertexAttr<0, T, N, Normalized> { static constexpr const char *name = "position"; };
+template <typename T = GLfloat, int N = 3, bool Normalized = false>
+struct Color : VertexAttr<1, T, N, Normalized> { static constexpr const char *name = "color"; };
+template <typename T = GLfloat, int N = 2, bool Normalized = false>
+struct TexCoord : VertexAttr<2, T, N, Normalized> { static constexpr const char *name = "texc"; };
+template <typename T = GLfloat, int N = 3, bool Normalized = false>
+struct Normal : VertexAttr<3, T, N, Normalized> { static constexpr const char *name = "normal"; };
+
+template <typename... Attrs>
+class VertexLayout
+{
+public:
+	static_assert(sizeof...(Attrs) > 0, "formato de vértice vazio");
+
+	static constexpr size_t count = sizeof...(Attrs);
+	static constexpr GLsizei stride = (0 + ... + Attrs::size);
+
+	// Deslocamento em bytes do atributo I dentro do vértice
+	template <size_t I>
+	static constexpr size_t offset()
+	{
+		constexpr GLsizei sizes[] = {Attrs::size...};
+		size_t result = 0;
+		for (size_t i = 0; i < I; i++)
+			result += sizes[i];
+		return result;
+	}
+
+	// Configura os atributos no VAO vinculado, lendo do GL_ARRAY_BUFFER vinculado.
+	// baseOffset: onde o primeiro vértice começa no buffer; divisor > 0 para dados por instância.
+	static void setup(size_t baseOffset = 0, GLuint divisor = 0)
+	{
+		static_assert(aligned(), "atributos devem começar em múltiplos de 4 bytes (use VertexPad)");
+		setupAll(baseOffset, divisor, std::index_sequence_for<Attrs...>{});
+	}
+
+	// Declarações "layout (location = N) in ..." de todos os atributos, uma por linha
+	static std::string glslHeader(const char *separator = "\n")
+	{
+		std::string header;
+		(appendDeclaration<Attrs>(header, separator), ...);
+		return header;
+	}
+
+	// As mesmas declarações numa macro: "#define VERTEX_INPUTS layout (...) in ...; ..."
+	static std::string glslDefine(const std::string &macro = "VERTEX_INPUTS")
+	{
+		return "#define " + macro + " " + glslHeader(" ") + "\n";
+	}
+
+private:
+	static constexpr bool aligned()
+	{
+		constexpr GLsizei sizes[] = {Attrs::size...};
+		constexpr bool pads[] = {Attrs::padding...};
+		size_t position = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!pads[i] && position % 4 != 0)
+				return false;
+			position += sizes[i];
+		}
+		return position % 4 == 0;
+	}
+
+	template <size_t... I>
+	static void setupAll(size_t baseOffset, GLuint divisor, std::index_sequence<I...>)
+	{
+		(setupAttribute<Attrs>(baseOffset + offset<I>(), divisor), ...);
+	}
+
+	template <typename A>
+	static void setupAttribute(size_t attribOffset, GLuint divisor)
+	{
+		if constexpr (!A::padding)
+		{
+			if constexpr (A::integer)
+				glVertexAttribIPointer(A::location, A::components, A::glType, stride, (GLvoid *)attribOffset);
+			else
+				glVertexAttribPointer(A::location, A::components, A::glType, A::normalized, stride, (GLvoid *)attribOffset);
+			glEnableVertexAttribArray(A::location);
+			if (divisor)
+				glVertexAttribDivisor(A::location, divisor);
+		}
+	}
+
+	template <typename A>
+	static void appendDeclaration(std::string &header, const char *separator)
+	{
+		if constexpr (!A::padding)
+			header += "layout (location = " + std::to_string(A::location) + ") in " + A::glslType() + " " + A::name + ";" + separator;
+	}
+};
+
+// Formatos usados pela cena
+using ObjVertex = VertexLayout<Position<>, Color<>, TexCoord<>, Normal<>>; // modelos OBJ (posição, cor, textura, normal)
+using PositionVertex = VertexLayout<Position<>>;							// curvas, grade, eixos
+// Versão compacta do ObjVertex (variação QUANTIZED_VERTICES do phong): posição em GLshort
+// normalizado, que o shader leva de volta ao espaço do objeto com quantScale/quantOffset da
+// malha, cor em bytes e normal em GLshort normalizados. No GLSL os tipos são os mesmos do
+// ObjVertex (vec3, vec3, vec2, vec3), então as duas usam as mesmas declarações.
+using QuantizedObjVertex = VertexLayout<Position<GLshort, 3, true>, VertexPad<2>, Color<GLubyte, 3, true>, VertexPad<1>,
+										TexCoord<>, Normal<GLshort, 3, true>, VertexPad<2>>;
+
+static_assert(ObjVertex::stride == 11 * sizeof(GLfloat), "ObjVertex: 11 floats por vértice");
+static_assert(ObjVertex::offset<3>() == 8 * sizeof(GLfloat), "ObjVertex: normal depois de 8 floats");
+static_assert(QuantizedObjVertex::stride == 28, "QuantizedObjVertex: 28 bytes por vértice");
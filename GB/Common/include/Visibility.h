@@ -0,0 +1,181 @@
+// Visibilidade e montagem das listas de desenho em paralelo
+//
+// Frustum: os 6 planos do volume de visão extraídos da matriz projection * view
+// (Gribb e Hartmann), com teste de esfera envolvente.
+//
+// ParallelDrawLists: percorre N objetos em blocos com o JobSystem. Cada bloco testa
+// seus objetos (frustum, tamanho na tela, escolha de LOD...) e emite itens de desenho
+// em "baldes" (ex: um por modelo ou por passada). Os itens vão para listas da thread
+// que executou o bloco, sem trava nem atomic por item. No fim, merge() junta as listas
+// numa lista por balde, na ordem dos blocos: o resultado é o mesmo com 1 ou 16 threads.
+// Só a thread da OpenGL transforma as listas juntas em chamadas de desenho.
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+//GLM
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+
+struct Frustum
+{
+	glm::vec4 planes[6]; // ax + by + cz + d >= 0 dentro; normais normalizadas
+
+	Frustum() = default;
+
+	explicit Frustum(const glm::mat4 &viewProjection)
+	{
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+		planes[0] = row3 + row0; // esquerda
+		planes[1] = row3 - row0; // direita
+		planes[2] = row3 + row1; // baixo
+		planes[3] = row3 - row1; // cima
+		planes[4] = row3 + row2; // perto
+		planes[5] = row3 - row2; // longe
+		for (glm::vec4 &p : planes)
+			p /= glm::length(glm::vec3(p));
+	}
+
+	// Falso só quando a esfera está inteira fora de algum plano
+	bool intersectsSphere(const glm::vec3 &center, float radius) const
+	{
+		for (const glm::vec4 &p : planes)
+			if (glm::dot(glm::vec3(p), center) + p.w < -radius)
+				return false;
+		return true;
+	}
+};
+
+template <typename Item>
+class ParallelDrawLists
+{
+public:
+	static_assert(std::is_trivially_copyable<Item>::value, "itens são copiados com memcpy na junção");
+	static const int MAX_BUCKETS = 16;
+
+private:
+	// Faixa de um balde preenchida por um bloco
+	struct Segment
+	{
+		size_t chunk;
+		int bucket;
+		size_t begin, count;
+		size_t target; // posição na lista junta
+	};
+
+	struct ThreadLists
+	{
+		std::vector<std::vector<Item>> items; // um vetor por balde
+		std::vector<Segment> segments;
+	};
+
+public:
+	// Entregue ao bloco para emitir itens: emit(balde, item)
+	class Emitter
+	{
+	public:
+		void operator()(int bucket, const Item &item) { lists->items[bucket].push_back(item); }
+
+	private:
+		friend class ParallelDrawLists;
+		ThreadLists *lists;
+	};
+
+	explicit ParallelDrawLists(int buckets = 1)
+		: bucketCount(std::min(std::max(buckets, 1), MAX_BUCKETS)), mergedItems(bucketCount) {}
+
+	// Chama test(first, last, emit) para blocos de até "grain" objetos de [0, count) e
+	// junta os itens emitidos. Deve ser chamado de uma thread do JobSystem (ex: a principal).
+	template <typename Test>
+	void build(JobSystem &jobs, size_t count, size_t grain, Test &&test)
+	{
+		auto start = std::chrono::steady_clock::now();
+		grain = std::max<size_t>(grain, 1);
+		if (threads.size() != (size_t)jobs.threadCount())
+		{
+			threads.clear();
+			threads.resize(jobs.threadCount());
+		}
+		for (ThreadLists &t : threads)
+		{
+			t.items.resize(bucketCount);
+			for (std::vector<Item> &list : t.items)
+				list.clear();
+			t.segments.clear();
+		}
+
+		jobs.parallelFor(0, count, grain, [&](size_t first, size_t last) {
+			ThreadLists &lists = threads[std::max(jobs.currentThread(), 0)];
+			size_t begins[MAX_BUCKETS];
+			for (int b = 0; b < bucketCount; b++)
+				begins[b] = lists.items[b].size();
+			Emitter emit;
+			emit.lists = &lists;
+			test(first, last, emit);
+			for (int b = 0; b < bucketCount; b++)
+				if (lists.items[b].size() > begins[b])
+					lists.segments.push_back({first / grain, b, begins[b], lists.items[b].size() - begins[b], 0});
+		});
+		merge(jobs);
+		lastBuild = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Itens visíveis de um balde, na ordem dos objetos
+	const std::vector<Item> &merged(int bucket) const { return mergedItems[bucket]; }
+
+	size_t size() const
+	{
+		size_t total = 0;
+		for (const std::vector<Item> &list : mergedItems)
+			total += list.size();
+		return total;
+	}
+
+	// Tempo do último build (teste + junção), em microssegundos
+	double lastBuildMicroseconds() const { return lastBuild; }
+
+private:
+	int bucketCount;
+	std::vector<ThreadLists> threads;
+	std::vector<std::vector<Item>> mergedItems;
+	std::vector<std::pair<const ThreadLists *, Segment>> order;
+	double lastBuild = 0.0;
+
+	// Ordena as faixas por balde e bloco, calcula onde cada uma começa e copia em paralelo
+	void merge(JobSystem &jobs)
+	{
+		order.clear();
+		for (const ThreadLists &t : threads)
+			for (const Segment &s : t.segments)
+				order.push_back({&t, s});
+		std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+			return a.second.bucket != b.second.bucket ? a.second.bucket < b.second.bucket : a.second.chunk < b.second.chunk;
+		});
+
+		std::vector<size_t> totals(bucketCount, 0);
+		for (auto &entry : order)
+		{
+			entry.second.target = totals[entry.second.bucket];
+			totals[entry.second.bucket] += entry.second.count;
+		}
+		for (int b = 0; b < bucketCount; b++)
+			mergedItems[b].resize(totals[b]);
+
+		jobs.parallelFor(0, order.size(), 16, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++)
+			{
+				const Segment &s = order[i].second;
+				memcpy(mergedItems[s.bucket].data() + s.target, order[i].first->items[s.bucket].data() + s.begin, s.count * sizeof(Item));
+			}
+		});
+	}
+};
@@ -0,0 +1,215 @@
+/*
+ * Benchmark e verificação do alocador buddy
+ *
+ * Descrição:
+ * Exercita o BuddyAllocator usado pelo GeometryPool (sem OpenGL) e confere a fusão dos
+ * blocos livres depois de cada teste:
+ *   fill      - ocupa toda a capacidade com blocos mínimos e libera em ordem aleatória
+ *   grow      - cheio, o pedido falha; grow() dobra a capacidade e a nova metade funde com a velha
+ *   churn     - alocações e liberações aleatórias de tamanhos variados, sem sobreposição
+ *   repack    - realoca as faixas vivas da maior para a menor, como o defragment() do pool
+ *
+ * Ao final de cada teste tudo é liberado e o maior bloco livre precisa voltar a ser a
+ * capacidade inteira. Para cada teste é impresso o melhor tempo entre as repetições e o
+ * custo por operação em nanossegundos; falhas saem como ERROR::BUDDY::...
+ *
+ * Uso: BuddyBenchmark [--capacity 65536] [--ops 200000] [--repeat 5]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+#include "BuddyAllocator.h"
+
+static size_t capacity = 65536;
+static int numOps = 200000;
+static int repeat = 5;
+static int failures = 0;
+
+// Melhor tempo (ms) entre as repetições
+template <typename Fn>
+double measure(Fn fn)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeat; i++)
+	{
+		auto start = chrono::steady_clock::now();
+		fn();
+		auto end = chrono::steady_clock::now();
+		best = std::min(best, chrono::duration<double, milli>(end - start).count());
+	}
+	return best;
+}
+
+void printRow(const string &name, double ms, long ops)
+{
+	cout << "  " << left << setw(8) << name << right << setw(10) << fixed << setprecision(3) << ms << " ms"
+		 << setw(10) << ops << " ops" << setw(10) << setprecision(1) << (ms * 1e6 / std::max(ops, 1L)) << " ns/op\n";
+}
+
+void check(bool ok, const string &what)
+{
+	if (ok)
+		return;
+	failures++;
+	cout << "ERROR::BUDDY::" << what << endl;
+}
+
+// Tudo liberado: nada em uso e um único bloco livre do tamanho da capacidade
+void checkCoalesced(const BuddyAllocator &allocator, const string &test)
+{
+	check(allocator.used() == 0 && allocator.allocations() == 0, test + "_LEAK");
+	check(allocator.largestFree() == allocator.capacity(), test + "_NOT_COALESCED");
+}
+
+// Faixa viva do churn/repack
+struct Block
+{
+	size_t offset, count;
+};
+
+// Nenhuma faixa invade a outra (os blocos reservados são os arredondados por blockFor)
+bool disjoint(const BuddyAllocator &allocator, vector<Block> blocks)
+{
+	sort(blocks.begin(), blocks.end(), [](const Block &a, const Block &b) { return a.offset < b.offset; });
+	for (size_t i = 1; i < blocks.size(); i++)
+		if (blocks[i - 1].offset + allocator.blockFor(blocks[i - 1].count) > blocks[i].offset)
+			return false;
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		string arg = argv[i];
+		if (arg == "--capacity")
+			capacity = (size_t)std::max(64, atoi(argv[i + 1]));
+		else if (arg == "--ops")
+			numOps = std::max(1, atoi(argv[i + 1]));
+		else if (arg == "--repeat")
+			repeat = std::max(1, atoi(argv[i + 1]));
+		else
+			cout << "Unknown option " << arg << endl;
+	}
+
+	BuddyAllocator allocator;
+	allocator.reset(capacity);
+	cout << "Buddy allocator: capacity " << allocator.capacity() << " units, minimum block " << allocator.blockFor(1)
+		 << ", " << numOps << " ops, best of " << repeat << "\n\n";
+
+	// fill: cada liberação funde com o irmão assim que ele também estiver livre
+	mt19937 rng(1234);
+	size_t blocks = allocator.capacity() / allocator.blockFor(1);
+	double ms = measure([&] {
+		allocator.reset(capacity);
+		vector<size_t> offsets;
+		offsets.reserve(blocks);
+		for (size_t i = 0; i < blocks; i++)
+			offsets.push_back(allocator.allocate(1));
+		check(allocator.allocate(1) == BuddyAllocator::INVALID, "FILL_OVERCOMMIT");
+		check(allocator.used() == allocator.capacity(), "FILL_USED");
+		shuffle(offsets.begin(), offsets.end(), rng);
+		for (size_t offset : offsets)
+			allocator.release(offset);
+		checkCoalesced(allocator, "FILL");
+	});
+	printRow("fill", ms, (long)blocks * 2);
+
+	// grow: a faixa nova começa na capacidade antiga, e liberar tudo volta a um bloco só
+	ms = measure([&] {
+		allocator.reset(capacity);
+		size_t whole = allocator.allocate(allocator.capacity());
+		check(whole == 0, "GROW_FIRST_OFFSET");
+		size_t oldCapacity = allocator.capacity();
+		check(allocator.allocate(1) == BuddyAllocator::INVALID, "GROW_OVERCOMMIT");
+		allocator.grow();
+		check(allocator.capacity() == oldCapacity * 2, "GROW_CAPACITY");
+		size_t extra = allocator.allocate(oldCapacity / 2);
+		check(extra == oldCapacity, "GROW_OFFSET");
+		allocator.release(whole);
+		allocator.release(extra);
+		checkCoalesced(allocator, "GROW");
+	});
+	printRow("grow", ms, 4);
+
+	// churn: metade das operações aloca (crescendo quando falta espaço), metade libera
+	ms = measure([&] {
+		allocator.reset(capacity);
+		vector<Block> live;
+		uniform_int_distribution<size_t> size(1, capacity / 64);
+		for (int i = 0; i < numOps; i++)
+		{
+			if (live.empty() || rng() % 2)
+			{
+				size_t count = size(rng);
+				size_t offset;
+				while ((offset = allocator.allocate(count)) == BuddyAllocator::INVALID)
+					allocator.grow();
+				live.push_back({offset, count});
+			}
+			else
+			{
+				size_t pick = rng() % live.size();
+				allocator.release(live[pick].offset);
+				live[pick] = live.back();
+				live.pop_back();
+			}
+		}
+		check(disjoint(allocator, live), "CHURN_OVERLAP");
+		for (const Block &b : live)
+			allocator.release(b.offset);
+		checkCoalesced(allocator, "CHURN");
+	});
+	printRow("churn", ms, numOps);
+
+	// repack: depois de liberar metade das faixas, realocar as vivas da maior para a menor
+	// num alocador novo não deixa buracos (o mesmo que o defragment() do GeometryPool faz)
+	long repacked = 0;
+	ms = measure([&] {
+		allocator.reset(capacity);
+		vector<Block> live;
+		uniform_int_distribution<size_t> size(1, capacity / 64);
+		for (int i = 0; i < numOps / 100; i++)
+		{
+			size_t count = size(rng);
+			size_t offset;
+			while ((offset = allocator.allocate(count)) == BuddyAllocator::INVALID)
+				allocator.grow();
+			live.push_back({offset, count});
+		}
+		shuffle(live.begin(), live.end(), rng);
+		for (size_t i = live.size() / 2; i < live.size(); i++)
+			allocator.release(live[i].offset);
+		live.resize(live.size() / 2);
+
+		sort(live.begin(), live.end(), [](const Block &a, const Block &b) { return a.count > b.count; });
+		BuddyAllocator packed;
+		packed.reset(allocator.capacity());
+		size_t end = 0;
+		for (Block &b : live)
+		{
+			b.offset = packed.allocate(b.count);
+			check(b.offset != BuddyAllocator::INVALID, "REPACK_NO_SPACE");
+			end = std::max(end, b.offset + packed.blockFor(b.count));
+		}
+		check(end == packed.used(), "REPACK_HOLES");
+		check(disjoint(packed, live), "REPACK_OVERLAP");
+		for (const Block &b : live)
+			packed.release(b.offset);
+		checkCoalesced(packed, "REPACK");
+		repacked = (long)live.size();
+	});
+	printRow("repack", ms, repacked);
+
+	cout << "\n" << (failures ? "FAILED" : "OK") << " (" << failures << " failed checks)\n";
+	return failures ? 1 : 0;
+}
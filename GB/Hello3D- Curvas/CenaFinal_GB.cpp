@@ -44,15 +44,55 @@ using namespace std;
 #include <vector>
 
 #include <random>
+#include <map>
 #include <algorithm>
 
 // Classes utilitárias
 #include "Shader.h"
+#include "GLExtensoes.h"
+#include "GpuMemory.h"
+#include "GLStateCache.h"
+#include "UniformBlocks.h"
+#include "ShaderPermutations.h"
+#include "PipelineTable.h"
+#include "VertexLayout.h"
+#include "MaterialRegistry.h"
+#include "GeometryPool.h"
+#include "InstanceBatch.h"
+#include "IndirectDrawList.h"
+#include "RenderQueue.h"
+#include "FrameRing.h"
+#include "TextureStreamer.h"
+#include "JobSystem.h"
+#include "Visibility.h"
+#include "FramePipeline.h"
+#include "FrameTiming.h"
+#include "OcclusionCulling.h"
+#include "DepthPrepass.h"
+#include "ShadowMap.h"
 
 // Protótipo da função de callback de teclado
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
-int loadSimpleOBJ(string filePATH, int &nVertices);
-GLuint loadTexture(string filePath, int &width, int &height);
+GLuint loadSimpleOBJ(string filePATH, int &nVertices, bool indexed = false);
+bool parseSimpleOBJ(string filePath, vector<GLfloat> &vBuffer);
+
+// Malha de um OBJ pronta para o pool. Montá-la só usa a CPU, então pode rodar em
+// qualquer thread; o envio (uploadOBJMesh) precisa da thread da OpenGL.
+struct ObjMesh
+{
+	vector<GLfloat> vertices;
+	vector<GLuint> indices; // vazio: malha sem índices
+	int nVertices = 0;		// vértices antes da indexação (3 por triângulo)
+	float radius = 0.0f;	// raio da esfera envolvente centrada na origem do modelo
+	bool ok = false;
+};
+bool buildOBJMesh(string filePath, bool indexed, ObjMesh &mesh);
+GLuint uploadOBJMesh(const ObjMesh &mesh);
+// Cópia da malha no formato QuantizedObjVertex (quantPool); escala e deslocamento levam as
+// posições de volta ao espaço do modelo no shader (setQuantization)
+GLuint uploadQuantizedMesh(const ObjMesh &mesh, glm::vec3 &scale, glm::vec3 &offset);
+// Oclusor (só posições) a partir da malha lida, com no máximo maxTriangles triângulos
+void buildOccluder(const ObjMesh &mesh, size_t maxTriangles, OccluderMesh &occluder);
 
 struct Curve
 {
@@ -76,12 +116,69 @@ struct GeometryAxes
 
 struct Object
 {
-	GLuint VAO; //Índice do buffer de geometria
+	GLuint VAO; //Índice do buffer de geometria (o VAO do pool, compartilhado)
+	GLuint mesh; //faixa da malha no pool de geometria
+	GLuint depthMesh; //faixa só com posições, para a pré-passada de profundidade
 	GLuint texID; //Identificador da textura carregada
 	int nVertices; //nro de vértices
 	glm::mat4 model; //matriz de transformações do objeto
-	float ka, kd, ks; //coeficientes de iluminação - material do objeto
+	float ka, kd, ks, q; //coeficientes de iluminação - material do objeto
+	GLuint material; //índice do material no MaterialRegistry
+	float radius; //raio da esfera envolvente (espaço do modelo)
+	GLuint quantMesh; //faixa da cópia quantizada no quantPool
+	glm::vec3 quantScale, quantOffset; //da malha quantizada para o espaço do modelo
+
+};
+
+// Nave da frota: dados da instância e esfera envolvente no mundo, para o teste de visibilidade
+struct FleetShip
+{
+	InstanceData instance;
+	glm::vec3 center;
+	float radius;
+	int model; // 0 = Navezinha, 1 = Destroyer05 (balde da lista de desenho)
+};
 
+// Seleção de objeto e eixo de rotação escolhidos pelo teclado
+struct RotationControls
+{
+	int selected;
+	bool x, y, z;
+};
+
+// Entrada da simulação: copiada dos globais do teclado na thread principal, no início do
+// quadro (a simulação pode estar rodando em outra thread)
+struct SimInput
+{
+	double time;
+	RotationControls controls;
+	glm::vec3 cameraPos, cameraFront, cameraUp;
+};
+
+// Estado da animação e matrizes prontas para o render; não muda depois de publicado
+struct SimSnapshot
+{
+	FixedTimestep clock;	   // passos de 1/FPS em tempo double
+	int index = 0;			   // ponto atual em curvaBezier (último passo)
+	int previousIndex = 0;	   // ponto no passo anterior
+	float stepAngle = 0.0f;	   // direção do movimento no último passo
+	float previousAngle = 0.0f;
+	// Interpolados entre os dois últimos passos pelo alpha do relógio
+	float angle = 0.0f;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::mat4 objModel = glm::mat4(1), obj2Model = glm::mat4(1);
+	glm::mat4 view = glm::mat4(1);
+	glm::vec3 cameraPos = glm::vec3(0.0f);
+};
+
+// Pacote da fila de desenho: tudo o que a chamada de desenho de um objeto precisa
+struct ScenePacket
+{
+	RenderPass pass;
+	const Shader *shader;
+	GLuint mesh, VAO, texID, material;
+	glm::mat4 model;
+	const Object *quantized; // não nulo: a malha é a cópia quantizada desse objeto
 };
 
 
@@ -93,28 +190,99 @@ void generateCatmullRomCurvePoints(Curve &curve, int numPoints);
 void displayCurve(const Curve &curve);
 GLuint generateControlPointsBuffer(vector<glm::vec3> controlPoints);
 
-void drawOBJ(GLuint shaderID, Object obj, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color = glm::vec3(0.0, 0.0, 1.0), glm::vec3 axis = glm::vec3(0.0, 0.0, 1.0));
-void drawOBJ2(GLuint shaderID, Object obj, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color = glm::vec3(0.0, 0.0, 1.0), glm::vec3 axis = glm::vec3(0.0, 0.0, 1.0));
+RotationControls rotationControls();
+glm::mat4 objectModel(const Object &obj, const RotationControls &controls, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 axis = glm::vec3(0.0, 0.0, 1.0));
+void drawOBJ(const Shader &shader, Object obj, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color = glm::vec3(0.0, 0.0, 1.0), glm::vec3 axis = glm::vec3(0.0, 0.0, 1.0));
+void drawOBJ2(const Shader &shader, Object obj, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color = glm::vec3(0.0, 0.0, 1.0), glm::vec3 axis = glm::vec3(0.0, 0.0, 1.0));
+void setQuantization(const Shader &shader, const glm::vec3 &scale, const glm::vec3 &offset);
 
 int setupTriangle();
 
 // Funções para geração da grid
 GeometryGrid generateGrid(float cellSize = 0.1f);
-void drawGrid(const GeometryGrid &grid, GLuint shaderID);
+void drawGrid(const GeometryGrid &grid, const Shader &shader);
 GeometryAxes createAxesVAO();
-void drawAxesVAO(const GeometryAxes &axes, GLuint shaderID);
+void drawAxesVAO(const GeometryAxes &axes, const Shader &shader);
 std::vector<glm::vec3> generateHeartControlPoints(int numPoints = 20);
+void buildFleet(std::vector<FleetShip> &fleet, int count, const std::vector<GLuint> &fleetMaterials, float naveRadius, float destroyerRadius);
 
 void generateGlobalBezierCurvePoints(Curve &curve, float a, float b, int numPoints);
 
 // Dimensões da janela (pode ser alterado em tempo de execução)
 const GLuint WIDTH = 2000, HEIGHT = 1000;
+// Planos de recorte da projeção (o distante também normaliza a profundidade das chaves de ordenação)
+const float NEAR_PLANE = 0.1f, FAR_PLANE = 100.0f;
 
 bool rotateX=false, rotateY=false, rotateZ=false;
 
 //variavel global seleção de obj
 int objSelecionado = 1;
 
+//Tarefas em paralelo (threads de trabalho + a principal); as que chamam a OpenGL rodam só na principal
+JobSystem jobs;
+
+//Registro da memória de GPU usada pelos buffers e texturas
+GpuMemoryRegistry gpuMemory;
+
+//Materiais de todos os objetos, num buffer indexado por desenho
+MaterialRegistry materials;
+
+//Vértices de todos os modelos OBJ num único buffer, com um VAO para o formato
+GeometryPool<ObjVertex> meshPool;
+
+//Cópia compacta do rato e do queijo (QuantizedObjVertex: 28 bytes por vértice contra 44),
+//desenhada pela variação QUANTIZED_VERTICES do phong (tecla Q alterna)
+GeometryPool<QuantizedObjVertex> quantPool;
+bool useQuantized = false;
+
+//Dados que mudam todo quadro (câmera, matrizes e comandos da passada indireta):
+//escritos com memcpy num buffer mapeado, uma região por quadro em voo
+FrameRing frameRing;
+
+//Desenhos do quadro, ordenados por estado e profundidade antes do envio
+RenderQueue<ScenePacket> renderQueue;
+
+//Simulação (animação na curva, matrizes, câmera) numa thread própria, um quadro à frente
+//do render (tecla P alterna com o laço sequencial)
+FramePipeline<SimInput, SimSnapshot> framePipeline;
+bool pipelinedFrame = false;
+bool pipelineChanged = false;
+
+//Ritmo de entrega dos quadros: vsync, vsync adaptativo, limitador ou livre (tecla V alterna)
+FramePacer framePacer;
+const double TARGET_FPS = 60.0;
+
+//Passada phong enviada com um glMultiDrawElementsIndirect por textura (tecla I liga/desliga)
+bool useIndirect = true;
+
+//Frota de naves desenhada por instanciamento (tecla F mostra/esconde, N troca a quantidade)
+bool showFleet = false;
+int fleetSize = 10000;
+bool fleetChanged = false;
+
+//Visibilidade da frota testada em paralelo a cada quadro, uma lista por modelo (tecla C liga/desliga o teste)
+bool cullFleet = true;
+ParallelDrawLists<InstanceData> fleetLists(2);
+//Naves menores que isso na tela (em pixels) não são desenhadas
+const float MIN_SHIP_PIXELS = 1.0f;
+//Oclusão por software: o rato e o queijo escondem as naves atrás deles (tecla O liga/desliga)
+bool occludeFleet = true;
+OcclusionBuffer occlusion;
+//Triângulos por oclusor: os maiores bastam para cobrir a silhueta
+const size_t OCCLUDER_TRIANGLES = 512;
+std::atomic<int> occludedShips(0);
+
+//Pré-passada de profundidade: a cena entra primeiro só no buffer de profundidade, da frente
+//para trás, e o phong roda uma vez por pixel (tecla E liga/desliga)
+bool useDepthPrepass = true;
+DepthPrepass depthPass;
+
+//Sombras da luz sobre a cena: mapa de profundidade desenhado do ponto de vista da luz,
+//lido pela variação SHADOWS do phong (tecla L liga/desliga)
+bool useShadows = false;
+ShadowMap shadowMap;
+const int SHADOW_MAP_SIZE = 2048;
+
 //Variáveis globais da câmera
 glm::vec3 cameraPos = glm::vec3(0.0f,0.0f,3.0f);
 glm::vec3 cameraFront = glm::vec3(0.0f,0.0,-1.0f);
@@ -137,62 +305,147 @@ int main()
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
     }
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_ALWAYS);
-
-    // Compilando e buildando o programa de shader
-    Shader shader = Shader("./hello-curves.vs", "./hello-curves.fs");
-    Shader shaderTri = Shader("./hello-triangle.vs", "./hello-curves.fs");
-	Shader shaderOBJ("phong.vs","phong.fs");
+    glx::loadExtensions();
+    framePacer.setMode(FramePacer::VSync, TARGET_FPS);
+
+    glState.enable(GL_DEPTH_TEST);
+    glState.depthFunc(GL_LESS);
+
+    // Compilando e buildando o programa de shader (ou carregando o binário do cache).
+    // Só o substituto é compilado na hora; os demais compilam em segundo plano
+    // enquanto o laço já desenha com o substituto.
+    double shaderStart = glfwGetTime();
+	Shader shaderFallback("fallback.vs", "fallback.fs", ObjVertex::glslDefine());
+    Shader shader = Shader("./hello-curves.vs", "./hello-curves.fs", "", ShaderCompileMode::Deferred);
+    Shader shaderTri = Shader("./hello-triangle.vs", "./hello-curves.fs", "", ShaderCompileMode::Deferred);
+	ShaderQueue shaderQueue;
+	shaderQueue.add(shader);
+	shaderQueue.add(shaderTri);
+	// Variações do phong: cada objeto usa só os recursos que tem (ex: sem textura, sem amostragem)
+	ShaderPermutations phong("phong.vs", "phong.fs", &shaderQueue, ObjVertex::glslDefine());
+	phong.prewarm({FEATURE_TEXTURED, FEATURE_INSTANCING | FEATURE_TEXTURED});
+	// Pré-passada: só posições (com e sem instâncias)
+	ShaderPermutations depthShaders("depth.vs", "depth.fs", &shaderQueue, PositionVertex::glslDefine());
+	depthShaders.prewarm({0, FEATURE_INSTANCING});
+    std::cout << "Shaders: " << (glfwGetTime() - shaderStart) * 1000.0 << " ms (cache hits " << programcache::hits
+              << ", misses " << programcache::misses << ", rejected " << programcache::rejected << ")" << std::endl;
 
     Object obj,obj2;
-	obj.VAO = loadSimpleOBJ("../Modelos3D/aratwearingabackpack/obj/model.obj",obj.nVertices);
-	obj2.VAO = loadSimpleOBJ("../Modelos3D/pieceofcheese/obj/model.obj",obj2.nVertices);
+	// Modelos da frota com índices: cada nave é desenhada muitas vezes, então vale reaproveitar os vértices
+	Object nave, destroyer;
+	meshPool.create(1 << 16, 1 << 10, &gpuMemory, "mesh pool");
+	quantPool.create(1 << 16, 1 << 10, &gpuMemory, "quantized pool");
+	depthPass.create(&gpuMemory);
+	// Os OBJ são lidos e indexados em paralelo; cada um, ao ficar pronto, agenda o envio
+	// ao pool na thread principal (que roda esses envios enquanto espera no wait)
+	struct ObjLoad
+	{
+		const char *path;
+		Object *target;
+		OccluderMesh *occluder; // nulo: o objeto não esconde nada
+		ObjMesh mesh;
+	};
+	// Só o rato e o queijo são oclusores: as naves são muitas e pequenas
+	OccluderMesh objOccluder, obj2Occluder;
+	ObjLoad objLoads[] = {{"../Modelos3D/aratwearingabackpack/obj/model.obj", &obj, &objOccluder, {}},
+						  {"../Modelos3D/pieceofcheese/obj/model.obj", &obj2, &obj2Occluder, {}},
+						  {"../Modelos3D/Navezinha/Nave.obj", &nave, nullptr, {}},
+						  {"../Modelos3D/Naves/Destroyer05.obj", &destroyer, nullptr, {}}};
+	JobCounter meshesLoaded;
+	for (ObjLoad &load : objLoads)
+		jobs.spawn([&load, &meshesLoaded] {
+			buildOBJMesh(load.path, true, load.mesh);
+			if (load.occluder)
+				buildOccluder(load.mesh, OCCLUDER_TRIANGLES, *load.occluder);
+			jobs.spawnMain([&load] {
+				load.target->mesh = uploadOBJMesh(load.mesh);
+				const size_t floatsPerVertex = ObjVertex::stride / sizeof(GLfloat);
+				load.target->depthMesh = load.mesh.ok ? depthPass.add(load.mesh.vertices.data(), load.mesh.vertices.size() / floatsPerVertex, floatsPerVertex,
+																	  load.mesh.indices.data(), load.mesh.indices.size())
+													  : DepthPrepass::Pool::INVALID_HANDLE;
+				load.target->nVertices = load.mesh.nVertices;
+				load.target->radius = load.mesh.radius;
+			}, &meshesLoaded);
+		}, &meshesLoaded);
+	jobs.wait(meshesLoaded);
+	// O rato e o queijo também vão quantizados (as naves só são desenhadas instanciadas)
+	for (ObjLoad &load : objLoads)
+		load.target->quantMesh = load.occluder ? uploadQuantizedMesh(load.mesh, load.target->quantScale, load.target->quantOffset)
+											   : GeometryPool<QuantizedObjVertex>::INVALID_HANDLE;
+	occlusion.create(384, 192);
+	obj.VAO = obj2.VAO = meshPool.vao();
+	// As texturas começam só com os mipmaps grossos; os finos chegam sob demanda
+	TextureStreamer texStreamer;
+	texStreamer.registry = &gpuMemory;
 	int texWidth,texHeight;
-	obj.texID = loadTexture("../Modelos3D/aratwearingabackpack/textures/texture_1.jpeg",texWidth,texHeight);
-    obj2.texID = loadTexture("../Modelos3D/pieceofcheese/textures/texture_1.jpeg",texWidth,texHeight);
+	obj.texID = texStreamer.load("../Modelos3D/aratwearingabackpack/textures/texture_1.jpeg",texWidth,texHeight);
+    obj2.texID = texStreamer.load("../Modelos3D/pieceofcheese/textures/texture_1.jpeg",texWidth,texHeight);
+
+	// Blocos compartilhados por todos os shaders: câmera (por quadro) e luz
+	UniformBuffer<FrameBlock> frameUBO;
+	UniformBuffer<LightBlock> lightUBO;
 
-	glUseProgram(shaderOBJ.ID);
+	frameRing.create(256 * 1024, &gpuMemory, "frame ring");
 
     //Matriz de modelo
 	glm::mat4 model = glm::mat4(1); //matriz identidade;
-	GLint modelLoc = glGetUniformLocation(shaderOBJ.ID, "model");
 	model = glm::rotate(model, /*(GLfloat)glfwGetTime()*/glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-	glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
 	//Matriz de view
 	glm::mat4 view = glm::lookAt(cameraPos,cameraPos + cameraFront,cameraUp);
-	glUniformMatrix4fv(glGetUniformLocation(shaderOBJ.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+	frameUBO.data.view = view;
+	frameUBO.data.cameraPos = cameraPos;
 	//Matriz de projeção
 	//glm::mat4 projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, -1.0f, 1.0f);
-	glm::mat4 projection = glm::perspective(glm::radians(39.6f),(float)WIDTH/HEIGHT,0.1f,100.0f);
-	glUniformMatrix4fv(glGetUniformLocation(shaderOBJ.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-	//Buffer de textura no shader
-	glUniform1i(glGetUniformLocation(shaderOBJ.ID, "texBuffer"), 0);
-
-	glEnable(GL_DEPTH_TEST);
-	glActiveTexture(GL_TEXTURE0);
-
-	//Propriedades da superfície
-	shaderOBJ.setFloat("ka",0.2);
-	shaderOBJ.setFloat("ks", 0.5);
-	shaderOBJ.setFloat("kd", 0.5);
-	shaderOBJ.setFloat("q", 10.0);
+	glm::mat4 projection = glm::perspective(glm::radians(39.6f),(float)WIDTH/HEIGHT,NEAR_PLANE,FAR_PLANE);
+	frameUBO.data.projection = projection;
+	frameUBO.create(FRAME_BLOCK_BINDING, &gpuMemory, "frame block");
+
+	//Buffer de textura no shader: unidade 0, fixada no GLSL com layout(binding = 0)
+	glState.activeTexture(GL_TEXTURE0);
+
+	//Propriedades da superfície de cada objeto: cada desenho passa só o índice do material
+	obj.ka = 0.2; obj.kd = 0.5; obj.ks = 0.5; obj.q = 10.0;
+	obj2.ka = 0.2; obj2.kd = 0.6; obj2.ks = 0.8; obj2.q = 32.0;
+	materials.create(&gpuMemory);
+	for (Object *o : {&obj, &obj2})
+		o->material = materials.add({o->ka, o->kd, o->ks, o->q});
+	std::vector<GLuint> fleetMaterials = {materials.add({0.2f, 0.5f, 0.9f, 64.0f}), materials.add({0.3f, 0.7f, 0.3f, 8.0f}),
+										  materials.add({0.1f, 0.8f, 0.6f, 32.0f}), materials.add({0.4f, 0.4f, 0.2f, 4.0f})};
+	materials.attach(meshPool.vao());
+	materials.attach(quantPool.vao());
+	materials.upload();
+
+	// Cada modelo da frota é um lote: todas as cópias visíveis saem num único desenho instanciado
+	InstanceBatch<ObjVertex> naveFleet, destroyerFleet;
+	naveFleet.create(meshPool, nave.mesh, &gpuMemory, "fleet Navezinha", &frameRing);
+	destroyerFleet.create(meshPool, destroyer.mesh, &gpuMemory, "fleet Destroyer05", &frameRing);
+	// Na pré-passada as naves leem as posições do pool de profundidade e as mesmas instâncias
+	GLuint naveDepthVAO = depthPass.instanced(naveFleet);
+	GLuint destroyerDepthVAO = depthPass.instanced(destroyerFleet);
+	std::vector<FleetShip> fleet;
+	buildFleet(fleet, fleetSize, fleetMaterials, nave.radius, destroyer.radius);
+	// Objetos da cena que usam o phong: um comando indireto cada, matriz e material por base instance
+	IndirectDrawList<ObjVertex> phongPass;
+	phongPass.create(meshPool, &gpuMemory, "phong pass", &frameRing);
+	if (!IndirectDrawList<ObjVertex>::supported())
+		useIndirect = false;
 
 	//Propriedades da fonte de luz
-	shaderOBJ.setVec3("lightPos",0.0, 20.0, 0.0);
-	shaderOBJ.setVec3("lightColor",3.0, 3.0, 3.0);
+	lightUBO.data.lightPos = glm::vec3(0.0, 20.0, 0.0);
+	lightUBO.data.lightColor = glm::vec3(3.0, 3.0, 3.0);
+	// A luz olha de cima para a região do rato, do queijo e da frota
+	if (shadowMap.create(SHADOW_MAP_SIZE, &gpuMemory))
+	{
+		shadowMap.look(lightUBO.data.lightPos, glm::vec3(0.0f, 0.0f, -5.0f), 9.0f, 40.0f);
+		lightUBO.data.lightSpace = shadowMap.lightSpace();
+	}
+	lightUBO.create(LIGHT_BLOCK_BINDING, &gpuMemory, "light block");
 
     // Criando a geometria do triângulo
     GLuint VAO = setupTriangle();
-    glm::vec3 position;
     glm::vec3 dimensions = glm::vec3(0.2, 0.2, 1.0);
-    int index = 0;
-    float lastTime = 0.0;
     float FPS = 60.0;
-    float angle = 0.0;
 
     // Estrutura para armazenar a curva de Bézier e pontos de controle
     Curve curvaBezier;
@@ -237,13 +490,93 @@ int main()
     cout << curvaBezier.curvePoints.size() << endl;
     cout << curvaCatmullRom.curvePoints.size() << endl;
 
-    shader.Use();
+    // Combinações de programa, formato de vértice e alvo usadas pela cena, aquecidas
+    // ainda no carregamento (os modelos têm o mesmo formato, então um VAO representa os dois)
+    PipelineTable pipelines;
+    RenderTargetFormat screenFormat; // RGBA8 + profundidade 24 bits, como a janela
+    pipelines.add("fallback obj", shaderFallback, obj.VAO, screenFormat);
+    pipelines.add("phong textured obj", phong.get(FEATURE_TEXTURED), obj.VAO, screenFormat);
+    pipelines.add("phong instanced fleet", phong.get(FEATURE_INSTANCING), naveFleet.vao(), screenFormat);
+    pipelines.add("phong indirect pass", phong.get(FEATURE_INSTANCING | FEATURE_TEXTURED), phongPass.vao(), screenFormat);
+    pipelines.add("depth prepass", depthShaders.get(0), depthPass.vao(), screenFormat);
+    pipelines.add("depth prepass fleet", depthShaders.get(FEATURE_INSTANCING), naveDepthVAO, screenFormat);
+    pipelines.add("phong textured obj shadowed", phong.get(FEATURE_TEXTURED | FEATURE_SHADOWS), obj.VAO, screenFormat);
+    pipelines.add("phong instanced fleet shadowed", phong.get(FEATURE_INSTANCING | FEATURE_SHADOWS), naveFleet.vao(), screenFormat);
+    pipelines.add("phong indirect pass shadowed", phong.get(FEATURE_INSTANCING | FEATURE_TEXTURED | FEATURE_SHADOWS), phongPass.vao(), screenFormat);
+    pipelines.add("phong quantized obj", phong.get(FEATURE_TEXTURED | FEATURE_QUANTIZED_VERTICES), quantPool.vao(), screenFormat);
+    pipelines.add("phong quantized obj shadowed", phong.get(FEATURE_TEXTURED | FEATURE_QUANTIZED_VERTICES | FEATURE_SHADOWS), quantPool.vao(), screenFormat);
+    RenderTargetFormat shadowFormat = {0, GL_DEPTH_COMPONENT24}; // só profundidade, como o mapa de sombra
+    pipelines.add("shadow map", depthShaders.get(0), depthPass.vao(), shadowFormat);
+    pipelines.add("shadow map fleet", depthShaders.get(FEATURE_INSTANCING), naveDepthVAO, shadowFormat);
+    int pendingPipelines = pipelines.warmUp();
+    std::cout << "Pipelines: " << pipelines.warmedCount() << " of " << pipelines.size() << " warmed ("
+              << pendingPipelines << " waiting for compilation)" << std::endl;
+
+    // Passo da simulação: só lê a entrada do quadro e dados que não mudam no laço (curva,
+    // dimensões, obj.model), então pode rodar fora da thread principal
+    auto simulate = [&](const SimInput &in, SimSnapshot &sim) {
+        // Passos fixos de 1/FPS segundos, um ponto da curva por passo, quantos couberem no
+        // tempo decorrido (independe da taxa de quadros)
+        int steps = sim.clock.advance(in.time);
+        for (int i = 0; i < steps; i++)
+        {
+            sim.previousIndex = sim.index;
+            sim.previousAngle = sim.stepAngle;
+            sim.index = (sim.index + 1) % curvaBezier.curvePoints.size(); // incrementando ciclicamente o indice do Frame
+            glm::vec3 dir = curvaBezier.curvePoints[sim.index] - curvaBezier.curvePoints[sim.previousIndex];
+            // O último ponto da elipse repete o primeiro: mantém a direção anterior
+            if (glm::length(dir) > 1e-6f)
+                sim.stepAngle = atan2(dir.y, dir.x) + glm::radians(-90.0f);
+        }
+
+        // Desenhar o triângulo: entre o passo anterior e o último, pela fração já decorrida
+        float alpha = (float)sim.clock.alpha();
+        sim.position = glm::mix(curvaBezier.curvePoints[sim.previousIndex], curvaBezier.curvePoints[sim.index], alpha);
+        // Interpola o ângulo pelo caminho mais curto
+        float turn = remainder(sim.stepAngle - sim.previousAngle, glm::two_pi<float>());
+        sim.angle = sim.previousAngle + turn * alpha;
+
+        //obj2
+        if (in.controls.selected == 1)
+        {
+            sim.obj2Model = glm::mat4(1); //matriz identidade
+            if (in.controls.x)
+                sim.obj2Model = glm::rotate(sim.obj2Model, sim.angle, glm::vec3(1.0f, 0.0f, 0.0f));
+            else if (in.controls.y)
+                sim.obj2Model = glm::rotate(sim.obj2Model, sim.angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            else if (in.controls.z)
+                sim.obj2Model = glm::rotate(sim.obj2Model, sim.angle, glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+        sim.objModel = objectModel(obj, in.controls, sim.position, dimensions, sim.angle);
+
+        sim.cameraPos = in.cameraPos;
+        sim.view = glm::lookAt(in.cameraPos, in.cameraPos + in.cameraFront, in.cameraUp);
+    };
+    auto frameInput = [] { return SimInput{glfwGetTime(), rotationControls(), cameraPos, cameraFront, cameraUp}; };
+    // O primeiro instantâneo já sai simulado; com mais de um núcleo, a simulação vai para outra thread
+    SimSnapshot initialState;
+    initialState.clock = FixedTimestep(1.0 / FPS);
+    simulate(frameInput(), initialState);
+    pipelinedFrame = std::thread::hardware_concurrency() > 1;
+    framePipeline.create(simulate, initialState, pipelinedFrame);
 
     // Loop da aplicação - "game loop"
     while (!glfwWindowShouldClose(window))
     {
         // Checa se houveram eventos de input (key pressed, mouse moved etc.) e chama as funções de callback correspondentes
         glfwPollEvents();
+        // Envios à OpenGL agendados por tarefas de outras threads
+        jobs.runMainThreadJobs();
+        if (pipelineChanged)
+        {
+            framePipeline.setThreaded(pipelinedFrame);
+            pipelineChanged = false;
+        }
+        // Entrega a entrada à simulação e pega o estado a desenhar (no modo em pipeline, o
+        // que a simulação terminou enquanto o quadro anterior era desenhado)
+        const SimSnapshot &sim = framePipeline.beginFrame(frameInput());
+        // Região do anel deste quadro (a GPU já terminou de ler o que estava nela)
+        frameRing.beginFrame();
 
         // Definindo as dimensões da viewport com as mesmas dimensões da janela da aplicação
         int width, height;
@@ -254,72 +587,275 @@ int main()
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // cor de fundo
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        //shaderTri.Use();
-        shaderOBJ.Use();
-        // Desenhar o triângulo
-        position = curvaBezier.curvePoints[index];
-
-        // Incrementando o índice do frame apenas quando fechar a taxa de FPS desejada
-        float now = glfwGetTime();
-        float dt = now - lastTime;
-        if (dt >= 1 / FPS)
+        //Atualizar a matriz de view: um único envio do bloco da câmera por quadro,
+        //antes de qualquer desenho
+		view = sim.view;
+		frameUBO.data.view = view;
+		frameUBO.data.cameraPos = sim.cameraPos;
+		frameUBO.upload(frameRing);
+
+        // Programas que terminaram de compilar passam a ser usados neste quadro
+        if (!shaderQueue.empty() && shaderQueue.poll() == 0)
+            std::cout << "Shaders ready after " << (glfwGetTime() - shaderStart) * 1000.0 << " ms" << std::endl;
+        // Os que acabaram de ficar prontos são aquecidos fora da tela antes do primeiro uso
+        pipelines.update();
+        // Sombras só com o mapa criado e os dois programas de profundidade prontos
+        const Shader *shadowShader = useShadows && shadowMap.isCreated() ? depthShaders.ready(0) : nullptr;
+        const Shader *shadowFleetShader = useShadows && shadowMap.isCreated() ? depthShaders.ready(FEATURE_INSTANCING) : nullptr;
+        bool shadows = shadowShader && pipelines.warmed(*shadowShader) && shadowFleetShader && pipelines.warmed(*shadowFleetShader);
+        uint32_t shadowFeature = shadows ? (uint32_t)FEATURE_SHADOWS : 0u;
+        // Variação de cada objeto (nula enquanto não estiver pronta e aquecida)
+        auto variantFor = [&](const Object &o, uint32_t features) -> const Shader * {
+            const Shader *variant = phong.ready((o.texID ? (uint32_t)FEATURE_TEXTURED : 0u) | shadowFeature | features);
+            return variant && pipelines.warmed(*variant) ? variant : nullptr;
+        };
+        // Enquanto a variação não estiver pronta, desenha com o substituto
+        auto shaderFor = [&](const Object &o) -> const Shader & {
+            const Shader *variant = variantFor(o, 0);
+            return variant ? *variant : shaderFallback;
+        };
+        // Com a variação INSTANCING+TEXTURED pronta, os objetos vão todos numa lista indireta
+        // (que só lê o pool em float: a cópia quantizada vai um desenho por objeto)
+        const Shader *indirectShader = useIndirect && !useQuantized ? phong.ready(FEATURE_INSTANCING | FEATURE_TEXTURED | shadowFeature) : nullptr;
+        bool indirect = indirectShader && pipelines.warmed(*indirectShader);
+
+        // Frota: as naves visíveis são escolhidas antes de qualquer desenho, porque a
+        // pré-passada também precisa delas
+        if (fleetChanged)
         {
-            index = (index + 1) % curvaBezier.curvePoints.size(); // incrementando ciclicamente o indice do Frame
-            lastTime = now;
-            glm::vec3 nextPos = curvaBezier.curvePoints[index];
-            glm::vec3 dir = glm::normalize(nextPos - position);
-            angle = atan2(dir.y, dir.x) + glm::radians(-90.0f);
+            buildFleet(fleet, fleetSize, fleetMaterials, nave.radius, destroyer.radius);
+            std::cout << "Fleet: " << fleetSize << " ships" << std::endl;
+            fleetChanged = false;
         }
-        
-        drawOBJ(shaderOBJ.ID, obj, position, dimensions, angle);
-
-        //obj2
-        if(objSelecionado == 1){
-            obj2.model = glm::mat4(1); //matriz identidade 
-            if (rotateX)
+        float fovY = glm::radians(39.6f);
+        const Shader *fleetShader = phong.ready(FEATURE_INSTANCING | shadowFeature);
+        bool drawFleet = showFleet && fleetShader && pipelines.warmed(*fleetShader);
+        if (drawFleet)
+        {
+            // Teste de visibilidade em blocos nas threads do JobSystem: cada uma emite as naves
+            // visíveis na lista do modelo; as listas juntas viram os lotes desenhados aqui
+            Frustum frustum(projection * view);
+            // Antes, os oclusores vão para o buffer de profundidade da CPU
+            bool occlude = cullFleet && occludeFleet;
+            if (occlude)
             {
-                obj2.model = glm::rotate(obj2.model, angle, glm::vec3(1.0f, 0.0f, 0.0f));
-                
+                occlusion.begin(projection * view);
+                occlusion.addOccluder(objOccluder, sim.objModel);
+                occlusion.addOccluder(obj2Occluder, sim.obj2Model);
+                occlusion.rasterize(jobs);
             }
-            else if (rotateY)
-            {
-                obj2.model = glm::rotate(obj2.model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+            occludedShips = 0;
+            fleetLists.build(jobs, fleet.size(), 2048, [&](size_t first, size_t last, auto &emit) {
+                int occluded = 0;
+                for (size_t i = first; i < last; i++)
+                {
+                    const FleetShip &ship = fleet[i];
+                    if (cullFleet && (!frustum.intersectsSphere(ship.center, ship.radius) ||
+                                      projectedSize(ship.radius, glm::distance(sim.cameraPos, ship.center), fovY, height) < MIN_SHIP_PIXELS))
+                        continue;
+                    if (occlude && !occlusion.isVisible(ship.center - glm::vec3(ship.radius), ship.center + glm::vec3(ship.radius)))
+                    {
+                        occluded++;
+                        continue;
+                    }
+                    emit(ship.model, ship.instance);
+                }
+                occludedShips += occluded;
+            });
+            naveFleet.assign(fleetLists.merged(0));
+            destroyerFleet.assign(fleetLists.merged(1));
+            naveFleet.upload();
+            destroyerFleet.upload();
+        }
 
+        // Mapa de sombra: a geometria da pré-passada, vista da luz (a frota entra com as naves
+        // que passaram no teste da câmera). O bloco da câmera recebe a view e a projeção da
+        // luz e volta para a câmera antes dos outros desenhos
+        if (shadows)
+        {
+            frameUBO.data.view = shadowMap.view();
+            frameUBO.data.projection = shadowMap.projection();
+            frameUBO.upload(frameRing);
+            shadowMap.begin();
+            shadowShader->Use();
+            const Object *casters[] = {&obj, &obj2};
+            glm::mat4 casterModels[] = {sim.objModel, sim.obj2Model};
+            for (int i = 0; i < 2; i++)
+            {
+                shadowShader->setMat4("model", glm::value_ptr(casterModels[i]));
+                depthPass.draw(casters[i]->depthMesh);
             }
-            else if (rotateZ)
+            if (drawFleet)
             {
-                obj2.model = glm::rotate(obj2.model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
-
+                shadowFleetShader->Use();
+                depthPass.drawInstanced(naveDepthVAO, naveFleet, nave.depthMesh);
+                depthPass.drawInstanced(destroyerDepthVAO, destroyerFleet, destroyer.depthMesh);
             }
+            shadowMap.end(width, height);
+            frameUBO.data.view = view;
+            frameUBO.data.projection = projection;
+            frameUBO.upload(frameRing);
+            shadowMap.bind();
         }
-		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(obj2.model));
-      
-        //Atualizar a matriz de view
-		//Matriz de view
-		view = glm::lookAt(cameraPos,cameraPos + cameraFront,cameraUp);
-		glUniformMatrix4fv(glGetUniformLocation(shaderOBJ.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
-		
-		// Chamada de desenho - drawcall
-		// Poligono Preenchido - GL_TRIANGLES
-		glBindVertexArray(obj2.VAO);
-        glBindTexture(GL_TEXTURE_2D,obj2.texID);
-		glDrawArrays(GL_TRIANGLES, 0, obj2.nVertices);
+
+        // Pré-passada só com os dois programas de profundidade prontos. A cópia quantizada não
+        // chega exatamente à mesma profundidade das posições em float: sem pré-passada
+        const Shader *depthShader = useDepthPrepass && !useQuantized ? depthShaders.ready(0) : nullptr;
+        const Shader *fleetDepthShader = useDepthPrepass && !useQuantized ? depthShaders.ready(FEATURE_INSTANCING) : nullptr;
+        bool prepass = depthShader && pipelines.warmed(*depthShader) && fleetDepthShader && pipelines.warmed(*fleetDepthShader);
+
+		// Cada objeto vira um pacote na fila: a ordem de desenho sai da chave (programa,
+		// textura, VAO e, por último, da frente para trás), não da ordem do código
+		renderQueue.clear();
+		auto queueObject = [&](const Object &o, const glm::mat4 &model) {
+			// Tecla Q: a cópia quantizada, assim que a variação estiver pronta
+			const Shader *quantShader = useQuantized && o.quantMesh != GeometryPool<QuantizedObjVertex>::INVALID_HANDLE
+											? variantFor(o, FEATURE_QUANTIZED_VERTICES)
+											: nullptr;
+			const Shader &program = quantShader ? *quantShader : (indirect ? *indirectShader : shaderFor(o));
+			GLuint mesh = quantShader ? o.quantMesh : o.mesh;
+			GLuint vao = quantShader ? quantPool.vao() : o.VAO;
+			float depth = glm::distance(sim.cameraPos, glm::vec3(model[3])) / FAR_PLANE;
+			renderQueue.push(sortkey::make(PASS_OPAQUE, program.ID, o.texID, vao, depth),
+							 {PASS_OPAQUE, &program, mesh, vao, o.texID, o.material, model, quantShader ? &o : nullptr});
+			// Na pré-passada todos têm o mesmo programa e VAO: a chave ordena só pela distância
+			if (prepass)
+				renderQueue.push(sortkey::make(PASS_DEPTH, depthShader->ID, 0, depthPass.vao(), depth),
+								 {PASS_DEPTH, depthShader, o.depthMesh, depthPass.vao(), 0, o.material, model, nullptr});
+		};
+		queueObject(obj, sim.objModel);
+		queueObject(obj2, sim.obj2Model);
+		renderQueue.sort();
+
+		if (prepass)
+		{
+			// Só profundidade, da frente para trás: primeiro os objetos da cena, depois a frota
+			depthPass.begin();
+			depthShader->Use();
+			renderQueue.submit(PASS_DEPTH, [&](const ScenePacket &p) {
+				glm::mat4 model = p.model;
+				depthShader->setMat4("model", glm::value_ptr(model));
+				depthPass.draw(p.mesh);
+			});
+			if (drawFleet)
+			{
+				fleetDepthShader->Use();
+				depthPass.drawInstanced(naveDepthVAO, naveFleet, nave.depthMesh);
+				depthPass.drawInstanced(destroyerDepthVAO, destroyerFleet, destroyer.depthMesh);
+			}
+			// Daqui em diante só passa o fragmento que ficou na frente
+			depthPass.end();
+		}
+
+		if (indirect)
+		{
+			// Uma chamada por textura, qualquer que seja o número de objetos
+			indirectShader->Use();
+			phongPass.clear();
+			renderQueue.submit(PASS_OPAQUE, [&](const ScenePacket &p) { phongPass.add(p.mesh, p.model, p.material, p.texID); });
+			phongPass.submit();
+		}
+		else
+		{
+			// Chamada de desenho - drawcall
+			// Poligono Preenchido - GL_TRIANGLES
+			renderQueue.submit(PASS_OPAQUE, [&](const ScenePacket &p) {
+				glm::mat4 model = p.model;
+				p.shader->Use();
+				p.shader->setMat4("model", glm::value_ptr(model));
+				if (p.quantized)
+					setQuantization(*p.shader, p.quantized->quantScale, p.quantized->quantOffset);
+				MeshRange range = p.quantized ? quantPool.range(p.mesh) : meshPool.range(p.mesh);
+				glState.bindVertexArray(p.VAO);
+				glState.bindTexture(GL_TEXTURE_2D, p.texID);
+				materials.drawElements(GL_TRIANGLES, range.indexCount, range.firstIndex, range.firstVertex, p.material);
+			});
+		}
+
+        // Frota: um desenho por modelo, qualquer que seja o número de naves
+        if (drawFleet)
+        {
+            fleetShader->Use();
+            naveFleet.draw();
+            destroyerFleet.draw();
+        }
+        if (prepass)
+            DepthPrepass::restore();
+
+        // Pede a resolução de textura de acordo com o tamanho projetado de cada objeto
+        texStreamer.requestResolution(obj.texID, projectedSize(glm::length(dimensions), glm::distance(sim.cameraPos, sim.position), fovY, height));
+        texStreamer.requestResolution(obj2.texID, projectedSize(1.0f, glm::distance(sim.cameraPos, glm::vec3(sim.obj2Model[3])), fovY, height));
+        texStreamer.update();
+        // O instantâneo pode ser reescrito a partir daqui
+        framePipeline.endFrame();
+        frameRing.endFrame();
+        gpuMemory.endFrame();
+        glState.endFrame();
 		
-        //drawOBJ2(shaderOBJ.ID, obj2, position, dimensions, angle);
+        //drawOBJ2(activeOBJ2, obj2, position, dimensions, angle);
 
-        // Troca os buffers da tela
+        // Troca os buffers da tela (segurando o quadro até o prazo, no modo limitado)
+        framePacer.wait();
         glfwSwapBuffers(window);
     }
     // Pede pra OpenGL desalocar os buffers
-    glDeleteVertexArrays(1, &VAOControl);
-    glDeleteVertexArrays(1, &VAOBezierCurve);
-    glDeleteVertexArrays(1, &VAOCatmullRomCurve);
+    framePipeline.stop();
+    texStreamer.shutdown();
+    jobs.shutdown();
+    depthPass.destroy();
+    shadowMap.destroy();
+    naveFleet.destroy();
+    phongPass.destroy();
+    frameRing.destroy();
+    destroyerFleet.destroy();
+    gpuMemory.releaseVertexArray(VAOControl);
+    gpuMemory.releaseVertexArray(VAOBezierCurve);
+    gpuMemory.releaseVertexArray(VAOCatmullRomCurve);
+    gpuMemory.releaseAll();
     // Finaliza a execução da GLFW, limpando os recursos alocados por ela
     glfwTerminate();
 
     return 0;
 }
 
+// Espalha as naves num bloco à frente da câmera, alternando os dois modelos,
+// com orientação e material sorteados (semente fixa: a frota é sempre a mesma)
+void buildFleet(std::vector<FleetShip> &fleet, int count, const std::vector<GLuint> &fleetMaterials, float naveRadius, float destroyerRadius)
+{
+
+    // Cada nave sorteia a partir do próprio índice (hash com semente fixa), então os
+    // blocos do parallelFor não dependem da ordem em que são executados
+    auto random = [](uint32_t x) {
+        x = (x ^ 42u) * 0x9E3779B1u;
+        x ^= x >> 16;
+        x *= 0x85EBCA6Bu;
+        x ^= x >> 13;
+        return x;
+    };
+
+    int side = (int)ceil(cbrt((double)count));
+    float spacing = 0.4f;
+    fleet.resize(count);
+    jobs.parallelFor(0, count, 1024, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+        {
+            int x = i % side, y = (i / side) % side, z = i / (side * side);
+            glm::vec3 position((x - (side - 1) * 0.5f) * spacing, (y - (side - 1) * 0.5f) * spacing, -3.0f - z * spacing);
+            uint32_t h = random((uint32_t)i);
+            glm::mat4 model = glm::translate(glm::mat4(1), position);
+            model = glm::rotate(model, (h >> 8) * (glm::two_pi<float>() / 16777216.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            // Navezinha tem ~2 unidades de largura, o Destroyer05 ~95
+            FleetShip &ship = fleet[i];
+            ship.model = i % 2;
+            float scale = ship.model == 0 ? 0.08f : 0.002f;
+            ship.instance.model = glm::scale(model, glm::vec3(scale));
+            ship.instance.material = fleetMaterials[(h & 0xFF) % fleetMaterials.size()];
+            ship.center = position;
+            ship.radius = (ship.model == 0 ? naveRadius : destroyerRadius) * scale;
+        }
+    });
+}
+
 void initializeBernsteinMatrix(glm::mat4 &matrix)
 {
     matrix[0] = glm::vec4(-1.0f, 3.0f, -3.0f, 1.0f); // Primeira coluna
@@ -409,34 +945,40 @@ void generateCatmullRomCurvePoints(Curve &curve, int numPoints)
 
 GLuint generateControlPointsBuffer(vector<glm::vec3> controlPoints)
 {
+    // Curvas, grade e eixos enviam vetores de glm::vec3 direto para o buffer
+    static_assert(PositionVertex::stride == sizeof(glm::vec3), "PositionVertex precisa ter o layout de glm::vec3");
     GLuint VBO, VAO;
 
     // Geração do identificador do VBO
     glGenBuffers(1, &VBO);
 
     // Faz a conexão (vincula) do buffer como um buffer de array
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
 
     // Envia os dados do array de floats para o buffer da OpenGl
-    glBufferData(GL_ARRAY_BUFFER, controlPoints.size() * sizeof(GLfloat) * 3, controlPoints.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, controlPoints.size() * PositionVertex::stride, controlPoints.data(), GL_STATIC_DRAW);
 
     // Geração do identificador do VAO (Vertex Array Object)
     glGenVertexArrays(1, &VAO);
 
     // Vincula (bind) o VAO primeiro, e em seguida  conecta e seta o(s) buffer(s) de vértices
     // e os ponteiros para os atributos
-    glBindVertexArray(VAO);
+    glState.bindVertexArray(VAO);
 
     // Atributo posição (x, y, z)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid *)0);
-    glEnableVertexAttribArray(0);
+    PositionVertex::setup();
 
     // Observe que isso é permitido, a chamada para glVertexAttribPointer registrou o VBO como o objeto de buffer de vértice
     // atualmente vinculado - para que depois possamos desvincular com segurança
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glState.bindBuffer(GL_ARRAY_BUFFER, 0);
 
     // Desvincula o VAO (é uma boa prática desvincular qualquer buffer ou array para evitar bugs medonhos)
-    glBindVertexArray(0);
+    glState.bindVertexArray(0);
+
+    // O VBO fica registrado junto com o VAO, para ser liberado com ele; acima do orçamento
+    // pode ser descartado e é reenviado a partir da cópia dos pontos no próximo desenho
+    gpuMemory.trackBuffer(VBO, GL_ARRAY_BUFFER, controlPoints.size() * PositionVertex::stride, GpuSubsystem::Debug, "curve points", VAO,
+                          GpuMemoryRegistry::reupload(VBO, controlPoints));
 
     return VAO;
 }
@@ -482,38 +1024,40 @@ GeometryGrid generateGrid(float cellSize)
     glGenVertexArrays(1, &grid.VAO);
     glGenBuffers(1, &grid.EBO);
 
-    glBindVertexArray(grid.VAO);
+    glState.bindVertexArray(grid.VAO);
 
     GLuint VBO;
     glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid.EBO);
+    glState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid.EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
 
     // Configura o layout dos atributos dos vértices
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
-    glEnableVertexAttribArray(0);
+    PositionVertex::setup();
 
-    glBindVertexArray(0); // Desvincula o VAO atual
+    glState.bindVertexArray(0); // Desvincula o VAO atual
 
-    // Limpeza
-    glDeleteBuffers(1, &VBO);
+    // Os buffers ficam registrados junto com o VAO, para serem liberados com ele (e recarregáveis)
+    gpuMemory.trackBuffer(VBO, GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), GpuSubsystem::Debug, "grid vertices", grid.VAO,
+                          GpuMemoryRegistry::reupload(VBO, vertices));
+    gpuMemory.trackBuffer(grid.EBO, GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), GpuSubsystem::Debug, "grid indices", grid.VAO,
+                          GpuMemoryRegistry::reupload(grid.EBO, indices));
 
     return grid;
 }
 
-void drawGrid(const GeometryGrid &grid, GLuint shaderID)
+void drawGrid(const GeometryGrid &grid, const Shader &shader)
 {
-    glUseProgram(shaderID);
+    shader.Use();
 
     // Define a cor cinza médio para a grid
-    GLint colorLocation = glGetUniformLocation(shaderID, "finalColor");
-    glUniform4f(colorLocation, 0.5f, 0.5f, 0.5f, 1.0f); // RGBA: cinza médio
+    shader.setVec4("finalColor", 0.5f, 0.5f, 0.5f, 1.0f); // RGBA: cinza médio
 
-    // Ativa o VAO da grid
-    glBindVertexArray(grid.VAO);
+    // Ativa o VAO da grid (recarregando os buffers, se o registro os tiver descartado)
+    gpuMemory.touchVertexArray(grid.VAO);
+    glState.bindVertexArray(grid.VAO);
 
     // Largura da grid
     glLineWidth(1.0f);
@@ -522,7 +1066,7 @@ void drawGrid(const GeometryGrid &grid, GLuint shaderID)
     glDrawElements(GL_LINES, (grid.dimensions.x / 0.1f + 1) * 4, GL_UNSIGNED_INT, 0);
 
     // Desvincula o VAO
-    glBindVertexArray(0);
+    glState.bindVertexArray(0);
 }
 
 GeometryAxes createAxesVAO()
@@ -538,36 +1082,38 @@ GeometryAxes createAxesVAO()
     glGenVertexArrays(1, &axes.VAO);
     glGenBuffers(1, &axes.VBO);
 
-    glBindVertexArray(axes.VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, axes.VBO);
+    glState.bindVertexArray(axes.VAO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, axes.VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(axisVertices), axisVertices, GL_STATIC_DRAW);
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *)0);
-    glEnableVertexAttribArray(0);
+    PositionVertex::setup();
 
-    glBindVertexArray(0); // Unbind VAO
+    glState.bindVertexArray(0); // Unbind VAO
+    gpuMemory.trackBuffer(axes.VBO, GL_ARRAY_BUFFER, sizeof(axisVertices), GpuSubsystem::Debug, "axes", axes.VAO,
+                          GpuMemoryRegistry::reupload(axes.VBO, std::vector<glm::vec3>(std::begin(axisVertices), std::end(axisVertices))));
     return axes;
 }
 
-void drawAxesVAO(const GeometryAxes &axes, GLuint shaderID)
+void drawAxesVAO(const GeometryAxes &axes, const Shader &shader)
 {
-    glUseProgram(shaderID);
+    shader.Use();
 
     // Desenha o eixo X em vermelho
-    GLint colorLocation = glGetUniformLocation(shaderID, "finalColor");
-    glUniform4f(colorLocation, 1.0f, 0.0f, 0.0f, 1.0f); // Cor vermelha
+    UniformHandle colorUniform = shader.uniform("finalColor");
+    shader.setVec4(colorUniform, 1.0f, 0.0f, 0.0f, 1.0f); // Cor vermelha
 
     // Largura dos eixos
     glLineWidth(3.0f);
 
-    glBindVertexArray(axes.VAO);
+    gpuMemory.touchVertexArray(axes.VAO);
+    glState.bindVertexArray(axes.VAO);
     glDrawArrays(GL_LINES, 0, 2); // Desenha o eixo X
 
     // Desenha o eixo Y em azul
-    glUniform4f(colorLocation, 0.0f, 0.0f, 1.0f, 1.0f); // Cor azul
+    shader.setVec4(colorUniform, 0.0f, 0.0f, 1.0f, 1.0f); // Cor azul
     glDrawArrays(GL_LINES, 2, 2);                       // Desenha o eixo Y
 
-    glBindVertexArray(0); // Unbind VAO
+    glState.bindVertexArray(0); // Unbind VAO
 }
 
 std::vector<glm::vec3> generateHeartControlPoints(int numPoints)
@@ -635,7 +1181,7 @@ int setupTriangle()
     // Geração do identificador do VBO
     glGenBuffers(1, &VBO);
     // Faz a conexão (vincula) do buffer como um buffer de array
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glState.bindBuffer(GL_ARRAY_BUFFER, VBO);
     // Envia os dados do array de floats para o buffer da OpenGl
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
@@ -643,7 +1189,7 @@ int setupTriangle()
     glGenVertexArrays(1, &VAO);
     // Vincula (bind) o VAO primeiro, e em seguida  conecta e seta o(s) buffer(s) de vértices
     // e os ponteiros para os atributos
-    glBindVertexArray(VAO);
+    glState.bindVertexArray(VAO);
     // Para cada atributo do vertice, criamos um "AttribPointer" (ponteiro para o atributo), indicando:
     //  Localização no shader * (a localização dos atributos devem ser correspondentes no layout especificado no vertex shader)
     //  Numero de valores que o atributo tem (por ex, 3 coordenadas xyz)
@@ -651,37 +1197,44 @@ int setupTriangle()
     //  Se está normalizado (entre zero e um)
     //  Tamanho em bytes
     //  Deslocamento a partir do byte zero
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid *)0);
-    glEnableVertexAttribArray(0);
+    PositionVertex::setup();
 
     // Observe que isso é permitido, a chamada para glVertexAttribPointer registrou o VBO como o objeto de buffer de vértice
     // atualmente vinculado - para que depois possamos desvincular com segurança
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glState.bindBuffer(GL_ARRAY_BUFFER, 0);
 
     // Desvincula o VAO (é uma boa prática desvincular qualquer buffer ou array para evitar bugs medonhos)
-    glBindVertexArray(0);
+    glState.bindVertexArray(0);
+
+    gpuMemory.trackBuffer(VBO, GL_ARRAY_BUFFER, sizeof(vertices), GpuSubsystem::Debug, "triangle", VAO,
+                          GpuMemoryRegistry::reupload(VBO, std::vector<GLfloat>(std::begin(vertices), std::end(vertices))));
 
     return VAO;
 }
 
-void drawOBJ(GLuint shaderID, Object obj, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color, glm::vec3 axis)
+// Estado atual das teclas de seleção e rotação
+RotationControls rotationControls()
+{
+    return {objSelecionado, rotateX, rotateY, rotateZ};
+}
+
+// Matriz de modelo: transformações na geometria (objeto)
+glm::mat4 objectModel(const Object &obj, const RotationControls &controls, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 axis)
 {
-    glBindVertexArray(obj.VAO);
-    // Matriz de modelo: transformações na geometria (objeto)
     glm::mat4 model = glm::mat4(1); // matriz identidade
     
-    if(objSelecionado == 0){
-        if (rotateX)
+    if(controls.selected == 0){
+        if (controls.x)
             {
                 model = glm::rotate(obj.model, angle, glm::vec3(1.0f, 0.0f, 0.0f));
                 
             }
-            else if (rotateY)
+            else if (controls.y)
             {
                 model = glm::rotate(obj.model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
 
             }
-            else if (rotateZ)
+            else if (controls.z)
             {
                 model = glm::rotate(obj.model, angle, glm::vec3(0.0f, 0.0f, 1.0f));
 
@@ -696,22 +1249,36 @@ void drawOBJ(GLuint shaderID, Object obj, glm::vec3 position, glm::vec3 dimensio
         // Escala
         model = glm::scale(model, dimensions);
     }
+    return model;
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(model));
+void drawOBJ(const Shader &shader, Object obj, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color, glm::vec3 axis)
+{
+    glState.bindVertexArray(obj.VAO);
+    glm::mat4 model = objectModel(obj, rotationControls(), position, dimensions, angle, axis);
+    shader.setMat4("model", glm::value_ptr(model));
 
-    glUniform4f(glGetUniformLocation(shaderID, "finalColor"), color.r, color.g, color.b, 1.0f); // enviando cor para variável uniform inputColor
+    shader.setVec4("finalColor", color.r, color.g, color.b, 1.0f); // enviando cor para variável uniform inputColor
                            
 
-    glBindTexture(GL_TEXTURE_2D,obj.texID);
-    glDrawArrays(GL_TRIANGLES, 0, obj.nVertices);
+    glState.bindTexture(GL_TEXTURE_2D,obj.texID);
+    MeshRange range = meshPool.range(obj.mesh);
+    materials.drawElements(GL_TRIANGLES, range.indexCount, range.firstIndex, range.firstVertex, obj.material);
 }
 
-void drawOBJ2(GLuint shaderID, Object obj2, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color, glm::vec3 axis)
+// Escala e deslocamento da cópia quantizada (variação QUANTIZED_VERTICES), com o programa ativo
+void setQuantization(const Shader &shader, const glm::vec3 &scale, const glm::vec3 &offset)
 {
-    glBindVertexArray(obj2.VAO);
+    shader.setVec3("quantScale", scale.x, scale.y, scale.z);
+    shader.setVec3("quantOffset", offset.x, offset.y, offset.z);
+}
 
-    glBindVertexArray(obj2.VAO);
-    glDrawArrays(GL_TRIANGLES, 0, obj2.nVertices);
+void drawOBJ2(const Shader &shader, Object obj2, glm::vec3 position, glm::vec3 dimensions, float angle, glm::vec3 color, glm::vec3 axis)
+{
+    glState.bindVertexArray(obj2.VAO);
+    glState.bindTexture(GL_TEXTURE_2D, obj2.texID);
+    MeshRange range = meshPool.range(obj2.mesh);
+    materials.drawElements(GL_TRIANGLES, range.indexCount, range.firstIndex, range.firstVertex, obj2.material);
 }
 
 // Função de callback de teclado - só pode ter uma instância (deve ser estática se
@@ -751,6 +1318,109 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 		rotateZ = true;
 	}
 
+	// Alterna entre a passada indireta e um desenho por objeto
+	if (key == GLFW_KEY_I && action == GLFW_PRESS)
+	{
+		useIndirect = !useIndirect;
+		std::cout << "Phong pass: " << (useIndirect ? "multi-draw indirect" : "one draw per object") << std::endl;
+	}
+
+	// Mostra/esconde a frota instanciada
+	if (key == GLFW_KEY_F && action == GLFW_PRESS)
+	{
+		showFleet = !showFleet;
+	}
+
+	// Modo de entrega dos quadros: vsync -> vsync adaptativo -> limitador -> livre
+	if (key == GLFW_KEY_V && action == GLFW_PRESS)
+	{
+		framePacer.setMode((FramePacer::Mode)((framePacer.mode() + 1) % 4), TARGET_FPS);
+		std::cout << "Frame pacing: " << framePacer.modeName() << std::endl;
+	}
+
+	// Alterna entre simulação em outra thread (pipeline) e laço sequencial
+	if (key == GLFW_KEY_P && action == GLFW_PRESS)
+	{
+		pipelinedFrame = !pipelinedFrame;
+		pipelineChanged = true;
+		std::cout << "Frame loop: " << (pipelinedFrame ? "pipelined simulation thread" : "sequential") << std::endl;
+	}
+
+	// Liga/desliga o teste de visibilidade da frota (desligado, todas as naves são desenhadas)
+	if (key == GLFW_KEY_C && action == GLFW_PRESS)
+	{
+		cullFleet = !cullFleet;
+		std::cout << "Fleet culling: " << (cullFleet ? "on" : "off") << std::endl;
+	}
+
+	// Liga/desliga a pré-passada de profundidade
+	if (key == GLFW_KEY_E && action == GLFW_PRESS)
+	{
+		useDepthPrepass = !useDepthPrepass;
+		std::cout << "Depth pre-pass: " << (useDepthPrepass ? "on" : "off") << std::endl;
+	}
+
+	// Liga/desliga a oclusão por software da frota (atrás do rato e do queijo)
+	if (key == GLFW_KEY_O && action == GLFW_PRESS)
+	{
+		occludeFleet = !occludeFleet;
+		std::cout << "Fleet occlusion culling: " << (occludeFleet ? "on" : "off") << std::endl;
+	}
+
+	// Cópia quantizada do rato e do queijo (sem pré-passada e sem a lista indireta)
+	if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+	{
+		useQuantized = !useQuantized;
+		std::cout << "Quantized vertices: " << (useQuantized ? "on" : "off") << std::endl;
+	}
+
+	// Sombras pelo mapa de profundidade da luz
+	if (key == GLFW_KEY_L && action == GLFW_PRESS)
+	{
+		useShadows = !useShadows;
+		std::cout << "Shadows: " << (useShadows ? "on" : "off") << std::endl;
+	}
+
+	// Quantidade de naves na frota: 1 mil, 10 mil, 100 mil
+	if (key == GLFW_KEY_N && action == GLFW_PRESS)
+	{
+		fleetSize = fleetSize >= 100000 ? 1000 : fleetSize * 10;
+		fleetChanged = true;
+	}
+
+	// Mostra o uso de memória da GPU
+	if (key == GLFW_KEY_M && action == GLFW_PRESS)
+	{
+		std::cout << gpuMemory.report() << meshPool.report() << quantPool.report() << depthPass.geometry().report();
+	}
+
+	// Reempacota os pools de geometria (as malhas mantêm os handles; só as faixas mudam)
+	if (key == GLFW_KEY_K && action == GLFW_PRESS)
+	{
+		int moved = meshPool.defragment() + quantPool.defragment() + depthPass.defragment();
+		std::cout << "Geometry pools defragmented, " << moved << " ranges moved" << std::endl;
+		std::cout << meshPool.report() << quantPool.report() << depthPass.geometry().report();
+	}
+
+	// Mostra quantas trocas de estado da OpenGL foram descartadas por serem redundantes
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+	{
+		std::cout << glState.report();
+		std::cout << "Frame ring: " << frameRing.size() / 1024 << " KB per frame, " << frameRing.stallCount() << " waits for the GPU"
+				  << (frameRing.isPersistent() ? "" : " (no persistent mapping)") << std::endl;
+		std::cout << "Render queue: " << renderQueue.size() << " packets sorted in " << renderQueue.lastSortMicroseconds() << " us" << std::endl;
+		std::cout << "Depth pre-pass: " << (useDepthPrepass ? "on" : "off") << std::endl;
+		std::cout << "Frame pacing: " << framePacer.modeName() << ", last frame " << framePacer.frameMilliseconds() << " ms (target "
+				  << framePacer.targetMilliseconds() << " ms)" << std::endl;
+		std::cout << "Simulation: " << framePipeline.lastSimulateMicroseconds() << " us per step, render waited "
+				  << framePipeline.lastWaitMicroseconds() << " us" << (framePipeline.isThreaded() ? " (pipelined)" : " (sequential)") << std::endl;
+		std::cout << "Fleet: " << fleetLists.size() << " of " << fleetSize << " ships visible, lists built in "
+				  << fleetLists.lastBuildMicroseconds() << " us on " << jobs.threadCount() << " threads" << std::endl;
+		std::cout << "Occlusion: " << occludedShips << " ships hidden, " << occlusion.triangleCount() << " occluder triangles in "
+				  << occlusion.width() << "x" << occlusion.height() << " rasterized in " << occlusion.lastRasterMicroseconds() << " us"
+				  << (occludeFleet ? "" : " (off)") << std::endl;
+	}
+
 	//Verifica a movimentação da câmera
 	float cameraSpeed = 0.05f;
 
@@ -772,202 +1442,236 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 	}
 }
 
-int loadSimpleOBJ(string filePath, int &nVertices)
+bool parseSimpleOBJ(string filePath, vector<GLfloat> &vBuffer)
 {
 	vector <glm::vec3> vertices;
 	vector <glm::vec2> texCoords;
 	vector <glm::vec3> normals;
-	vector <GLfloat> vBuffer;
 
 	glm::vec3 color = glm::vec3(1.0, 0.0, 0.0);
 
 	ifstream arqEntrada;
 
 	arqEntrada.open(filePath.c_str());
-	if (arqEntrada.is_open())
+	if (!arqEntrada.is_open())
 	{
-		//Fazer o parsing
-		string line;
-		while (!arqEntrada.eof())
+		cout << "Erro ao tentar ler o arquivo " << filePath << endl;
+		return false;
+	}
+
+	//Fazer o parsing
+	string line;
+	while (!arqEntrada.eof())
+	{
+		getline(arqEntrada,line);
+		istringstream ssline(line);
+		string word;
+		ssline >> word;
+		if (word == "v")
 		{
-			getline(arqEntrada,line);
-			istringstream ssline(line);
-			string word;
-			ssline >> word;
-			if (word == "v")
-			{
-				glm::vec3 vertice;
-				ssline >> vertice.x >> vertice.y >> vertice.z;
-				//cout << vertice.x << " " << vertice.y << " " << vertice.z << endl;
-				vertices.push_back(vertice);
+			glm::vec3 vertice;
+			ssline >> vertice.x >> vertice.y >> vertice.z;
+			//cout << vertice.x << " " << vertice.y << " " << vertice.z << endl;
+			vertices.push_back(vertice);
 
-			}
-			if (word == "vt")
-			{
-				glm::vec2 vt;
-				ssline >> vt.s >> vt.t;
-				//cout << vertice.x << " " << vertice.y << " " << vertice.z << endl;
-				texCoords.push_back(vt);
+		}
+		if (word == "vt")
+		{
+			glm::vec2 vt;
+			ssline >> vt.s >> vt.t;
+			//cout << vertice.x << " " << vertice.y << " " << vertice.z << endl;
+			texCoords.push_back(vt);
 
-			}
-			if (word == "vn")
-			{
-				glm::vec3 normal;
-				ssline >> normal.x >> normal.y >> normal.z;
-				//cout << vertice.x << " " << vertice.y << " " << vertice.z << endl;
-				normals.push_back(normal);
+		}
+		if (word == "vn")
+		{
+			glm::vec3 normal;
+			ssline >> normal.x >> normal.y >> normal.z;
+			//cout << vertice.x << " " << vertice.y << " " << vertice.z << endl;
+			normals.push_back(normal);
 
-			}
-			else if (word == "f")
+		}
+		else if (word == "f")
+		{
+			while (ssline >> word) 
 			{
-				while (ssline >> word) 
-				{
-					int vi, ti, ni;
-					istringstream ss(word);
-    				std::string index;
-
-    				// Pega o índice do vértice
-    				std::getline(ss, index, '/');
-    				vi = std::stoi(index) - 1;  // Ajusta para índice 0
-
-    				// Pega o índice da coordenada de textura
-    				std::getline(ss, index, '/');
-    				ti = std::stoi(index) - 1;
-
-    				// Pega o índice da normal
-    				std::getline(ss, index);
-    				ni = std::stoi(index) - 1;
-
-					//Recuperando os vértices do indice lido
-					vBuffer.push_back(vertices[vi].x);
-					vBuffer.push_back(vertices[vi].y);
-					vBuffer.push_back(vertices[vi].z);
-					
-					//Atributo cor
-					vBuffer.push_back(color.r);
-					vBuffer.push_back(color.g);
-					vBuffer.push_back(color.b);
-
-					//Atributo coordenada de textura
-					vBuffer.push_back(texCoords[ti].s);
-					vBuffer.push_back(texCoords[ti].t);
-
-					//Atributo vetor normal
-					vBuffer.push_back(normals[ni].x);
-					vBuffer.push_back(normals[ni].y);
-					vBuffer.push_back(normals[ni].z);
-					
-        			
-        			// Exibindo os índices para verificação
-       				// std::cout << "v: " << vi << ", vt: " << ti << ", vn: " << ni << std::endl;
-    			}
+				int vi, ti, ni;
+				istringstream ss(word);
+				std::string index;
+
+				// Pega o índice do vértice
+				std::getline(ss, index, '/');
+				vi = std::stoi(index) - 1;  // Ajusta para índice 0
+
+				// Pega o índice da coordenada de textura
+				std::getline(ss, index, '/');
+				ti = std::stoi(index) - 1;
+
+				// Pega o índice da normal
+				std::getline(ss, index);
+				ni = std::stoi(index) - 1;
+
+				//Recuperando os vértices do indice lido
+				vBuffer.push_back(vertices[vi].x);
+				vBuffer.push_back(vertices[vi].y);
+				vBuffer.push_back(vertices[vi].z);
+				
+				//Atributo cor
+				vBuffer.push_back(color.r);
+				vBuffer.push_back(color.g);
+				vBuffer.push_back(color.b);
+
+				//Atributo coordenada de textura
+				vBuffer.push_back(texCoords[ti].s);
+				vBuffer.push_back(texCoords[ti].t);
+
+				//Atributo vetor normal
+				vBuffer.push_back(normals[ni].x);
+				vBuffer.push_back(normals[ni].y);
+				vBuffer.push_back(normals[ni].z);
 				
+				
+				// Exibindo os índices para verificação
+				// std::cout << "v: " << vi << ", vt: " << ti << ", vn: " << ni << std::endl;
 			}
+			
 		}
+	}
 
-		arqEntrada.close();
-
-		cout << "Gerando o buffer de geometria..." << endl;
-		GLuint VBO, VAO;
-
-	//Geração do identificador do VBO
-	glGenBuffers(1, &VBO);
-
-	//Faz a conexão (vincula) do buffer como um buffer de array
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	//Envia os dados do array de floats para o buffer da OpenGl
-	glBufferData(GL_ARRAY_BUFFER, vBuffer.size() * sizeof(GLfloat), vBuffer.data(), GL_STATIC_DRAW);
-
-	//Geração do identificador do VAO (Vertex Array Object)
-	glGenVertexArrays(1, &VAO);
-
-	// Vincula (bind) o VAO primeiro, e em seguida  conecta e seta o(s) buffer(s) de vértices
-	// e os ponteiros para os atributos 
-	glBindVertexArray(VAO);
-	
-	//Para cada atributo do vertice, criamos um "AttribPointer" (ponteiro para o atributo), indicando: 
-	// Localização no shader * (a localização dos atributos devem ser correspondentes no layout especificado no vertex shader)
-	// Numero de valores que o atributo tem (por ex, 3 coordenadas xyz) 
-	// Tipo do dado
-	// Se está normalizado (entre zero e um)
-	// Tamanho em bytes 
-	// Deslocamento a partir do byte zero 
-	
-	//Atributo posição (x, y, z)
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
-
-	//Atributo cor (r, g, b)
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(3*sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
-
-	//Atributo coordenada de textura - s, t
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(6*sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
+	arqEntrada.close();
+	return true;
+}
 
-	//Atributo vetor normal - x, y, z
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 11 * sizeof(GLfloat), (GLvoid*)(8*sizeof(GLfloat)));
-	glEnableVertexAttribArray(3);
+GLuint loadSimpleOBJ(string filePath, int &nVertices, bool indexed)
+{
+	ObjMesh mesh;
+	buildOBJMesh(filePath, indexed, mesh);
+	nVertices = mesh.nVertices;
+	return uploadOBJMesh(mesh);
+}
 
-	// Observe que isso é permitido, a chamada para glVertexAttribPointer registrou o VBO como o objeto de buffer de vértice 
-	// atualmente vinculado - para que depois possamos desvincular com segurança
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+bool buildOBJMesh(string filePath, bool indexed, ObjMesh &mesh)
+{
+	vector <GLfloat> vBuffer;
 
-	// Desvincula o VAO (é uma boa prática desvincular qualquer buffer ou array para evitar bugs medonhos)
-	glBindVertexArray(0);
+	mesh = ObjMesh();
+	if (!parseSimpleOBJ(filePath, vBuffer))
+		return false;
 
-	nVertices = vBuffer.size() / 11;
-	return VAO;
+	cout << "Gerando o buffer de geometria..." << endl;
 
+	mesh.nVertices = vBuffer.size() * sizeof(GLfloat) / ObjVertex::stride;
+	mesh.ok = true;
+	const size_t floatsPerVertex = ObjVertex::stride / sizeof(GLfloat);
+	for (int v = 0; v < mesh.nVertices; v++)
+		mesh.radius = std::max(mesh.radius, glm::length(glm::make_vec3(&vBuffer[v * floatsPerVertex])));
+	if (!indexed)
+	{
+		mesh.vertices.swap(vBuffer);
+		return true;
 	}
-	else
+
+	// Com índices: vértices idênticos (posição, cor, textura e normal) são guardados uma vez só
+	map<vector<GLfloat>, GLuint> unique;
+	mesh.indices.reserve(mesh.nVertices);
+	for (int v = 0; v < mesh.nVertices; v++)
 	{
-		cout << "Erro ao tentar ler o arquivo " << filePath << endl;
-		return -1;
+		vector<GLfloat> key(vBuffer.begin() + v * floatsPerVertex, vBuffer.begin() + (v + 1) * floatsPerVertex);
+		auto it = unique.find(key);
+		if (it == unique.end())
+		{
+			it = unique.emplace(key, (GLuint)(mesh.vertices.size() / floatsPerVertex)).first;
+			mesh.vertices.insert(mesh.vertices.end(), key.begin(), key.end());
+		}
+		mesh.indices.push_back(it->second);
 	}
+	return true;
 }
 
-GLuint loadTexture(string filePath, int &width, int &height)
+void buildOccluder(const ObjMesh &mesh, size_t maxTriangles, OccluderMesh &occluder)
 {
-	GLuint texID; // id da textura a ser carregada
-
-	// Gera o identificador da textura na memória
-	glGenTextures(1, &texID);
-	glBindTexture(GL_TEXTURE_2D, texID);
-
-	// Ajuste dos parâmetros de wrapping e filtering
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-	// Carregamento da imagem usando a função stbi_load da biblioteca stb_image
-	int nrChannels;
+	occluder = OccluderMesh();
+	if (!mesh.ok)
+		return;
+	const size_t floatsPerVertex = ObjVertex::stride / sizeof(GLfloat);
+	size_t count = mesh.vertices.size() / floatsPerVertex;
+	occluder.positions.reserve(count);
+	for (size_t v = 0; v < count; v++)
+		occluder.positions.push_back(glm::make_vec3(&mesh.vertices[v * floatsPerVertex]));
+	if (mesh.indices.empty())
+		for (size_t v = 0; v < count; v++)
+			occluder.indices.push_back((uint32_t)v);
+	else
+		occluder.indices.assign(mesh.indices.begin(), mesh.indices.end());
+	occluder.simplify(maxTriangles);
+}
 
-	unsigned char *data = stbi_load(filePath.c_str(), &width, &height, &nrChannels, 0);
+GLuint uploadOBJMesh(const ObjMesh &mesh)
+{
+	if (!mesh.ok)
+		return GeometryPool<ObjVertex>::INVALID_HANDLE;
+
+	// Os vértices vão para o buffer compartilhado do formato ObjVertex: a malha vira só
+	// uma faixa (primeiro vértice e quantidade) e todas usam o mesmo VAO
+	const size_t floatsPerVertex = ObjVertex::stride / sizeof(GLfloat);
+	size_t vertexCount = mesh.vertices.size() / floatsPerVertex;
+	if (mesh.indices.empty())
+		return meshPool.add(mesh.vertices.data(), vertexCount);
+	return meshPool.add(mesh.vertices.data(), vertexCount, mesh.indices.data(), mesh.indices.size());
+}
 
-	if (data)
+GLuint uploadQuantizedMesh(const ObjMesh &mesh, glm::vec3 &scale, glm::vec3 &offset)
+{
+	const size_t floatsPerVertex = ObjVertex::stride / sizeof(GLfloat);
+	size_t vertexCount = mesh.vertices.size() / floatsPerVertex;
+	if (!mesh.ok || vertexCount == 0)
+		return GeometryPool<QuantizedObjVertex>::INVALID_HANDLE;
+
+	// Caixa envolvente da malha: o centro vira o deslocamento e a metade do tamanho, a
+	// escala, então cada eixo usa todo o intervalo [-1, 1] do GLshort normalizado
+	glm::vec3 lo = glm::make_vec3(&mesh.vertices[0]), hi = lo;
+	for (size_t v = 1; v < vertexCount; v++)
 	{
-		if (nrChannels == 3) // jpg, bmp
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-		}
-		else // assume que é 4 canais png
-		{
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		}
-		glGenerateMipmap(GL_TEXTURE_2D);
+		glm::vec3 p = glm::make_vec3(&mesh.vertices[v * floatsPerVertex]);
+		lo = glm::min(lo, p);
+		hi = glm::max(hi, p);
 	}
-	else
+	offset = (lo + hi) * 0.5f;
+	scale = (hi - lo) * 0.5f;
+	for (int axis = 0; axis < 3; axis++)
+		if (scale[axis] <= 0.0f)
+			scale[axis] = 1.0f;
+
+	// Mesmo arranjo do QuantizedObjVertex
+	struct Packed
+	{
+		GLshort position[3], pad0;
+		GLubyte color[3], pad1;
+		GLfloat texc[2];
+		GLshort normal[3], pad2;
+	};
+	static_assert(sizeof(Packed) == QuantizedObjVertex::stride, "Packed fora do formato QuantizedObjVertex");
+	auto snorm = [](float x) { return (GLshort)std::lround(glm::clamp(x, -1.0f, 1.0f) * 32767.0f); };
+
+	std::vector<Packed> packed(vertexCount, Packed{});
+	for (size_t v = 0; v < vertexCount; v++)
 	{
-		std::cout << "Failed to load texture " << filePath << std::endl;
+		const GLfloat *src = &mesh.vertices[v * floatsPerVertex];
+		Packed &dst = packed[v];
+		glm::vec3 position = (glm::make_vec3(src) - offset) / scale;
+		glm::vec3 normal = glm::make_vec3(src + 8);
+		if (glm::length(normal) > 0.0f)
+			normal = glm::normalize(normal);
+		for (int i = 0; i < 3; i++)
+		{
+			dst.position[i] = snorm(position[i]);
+			dst.color[i] = (GLubyte)std::lround(glm::clamp(src[3 + i], 0.0f, 1.0f) * 255.0f);
+			dst.normal[i] = snorm(normal[i]);
+		}
+		dst.texc[0] = src[6];
+		dst.texc[1] = src[7];
 	}
-
-	stbi_image_free(data);
-
-	glBindTexture(GL_TEXTURE_2D, 0);
-
-	return texID;
-}
\ No newline at end of file
+	if (mesh.indices.empty())
+		return quantPool.add(packed.data(), vertexCount);
+	return quantPool.add(packed.data(), vertexCount, mesh.indices.data(), mesh.indices.size());
+}
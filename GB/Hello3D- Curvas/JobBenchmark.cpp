@@ -0,0 +1,190 @@
+/*
+ * Benchmark do sistema de tarefas
+ *
+ * Descrição:
+ * Mede o custo de criar e executar tarefas no JobSystem (sem OpenGL):
+ *   spawn     - a thread principal cria N tarefas vazias e espera por elas
+ *   tree      - árvore binária de tarefas: cada uma cria duas filhas (exercita o roubo)
+ *   chain     - cadeia de continuações: cada tarefa é agendada quando a anterior termina
+ *   main      - tarefas da thread principal (spawnMain + runMainThreadJobs)
+ *   for       - parallelFor sobre um vetor de floats, comparado com o laço serial
+ *   async     - mesmo número de tarefas do spawn com std::async, como referência
+ *
+ * Para cada teste é impresso o melhor tempo entre as repetições e o custo por tarefa
+ * em nanossegundos.
+ *
+ * Uso: JobBenchmark [--workers 0] [--jobs 100000] [--repeat 5]
+ *      (--workers 0 = um por núcleo, menos a thread principal)
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <future>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+#include "JobSystem.h"
+
+static int numWorkers = 0;
+static int numJobs = 100000;
+static int repeat = 5;
+
+// Melhor tempo (ms) entre as repetições
+template <typename Fn>
+double measure(Fn fn)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeat; i++)
+	{
+		auto start = chrono::steady_clock::now();
+		fn();
+		auto end = chrono::steady_clock::now();
+		best = std::min(best, chrono::duration<double, milli>(end - start).count());
+	}
+	return best;
+}
+
+void printRow(const string &name, double ms, long tasks)
+{
+	cout << "  " << left << setw(8) << name << right << setw(10) << fixed << setprecision(3) << ms << " ms"
+		 << setw(10) << tasks << " tasks" << setw(10) << setprecision(1) << (ms * 1e6 / std::max(tasks, 1L)) << " ns/task\n";
+}
+
+// Cria duas filhas até a profundidade pedida
+void spawnTree(JobSystem &jobs, JobCounter &counter, int depth, atomic<long> &executed)
+{
+	executed.fetch_add(1, memory_order_relaxed);
+	if (depth == 0)
+		return;
+	for (int i = 0; i < 2; i++)
+		jobs.spawn([&jobs, &counter, depth, &executed] { spawnTree(jobs, counter, depth - 1, executed); }, &counter);
+}
+
+// Cada elo agenda o próximo como continuação de um contador próprio
+struct Chain
+{
+	JobSystem *jobs;
+	vector<JobCounter> *links;
+	atomic<int> *executed;
+	JobCounter *finished;
+
+	void link(int i) const
+	{
+		executed->fetch_add(1, memory_order_relaxed);
+		if (i + 1 < (int)links->size())
+		{
+			Chain next = *this;
+			jobs->then((*links)[i], [next, i] { next.link(i + 1); }, finished);
+		}
+	}
+};
+
+int main(int argc, char **argv)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		string arg = argv[i];
+		if (arg == "--workers")
+			numWorkers = std::max(0, atoi(argv[i + 1]));
+		else if (arg == "--jobs")
+			numJobs = std::max(1, atoi(argv[i + 1]));
+		else if (arg == "--repeat")
+			repeat = std::max(1, atoi(argv[i + 1]));
+		else
+			cout << "Unknown option " << arg << endl;
+	}
+
+	JobSystem jobs(numWorkers);
+	cout << "Job system: " << jobs.threadCount() << " threads (" << jobs.workerCount() << " workers + main), "
+		 << numJobs << " jobs, best of " << repeat << "\n\n";
+
+	// spawn: criação e execução de tarefas vazias
+	atomic<long> executed(0);
+	double ms = measure([&] {
+		JobCounter counter;
+		for (int i = 0; i < numJobs; i++)
+			jobs.spawn([&executed] { executed.fetch_add(1, memory_order_relaxed); }, &counter);
+		jobs.wait(counter);
+	});
+	printRow("spawn", ms, numJobs);
+
+	// tree: 2^(d+1) - 1 tarefas, quase todas criadas fora da thread principal
+	int depth = 1;
+	while ((2L << (depth + 1)) - 1 <= numJobs)
+		depth++;
+	long treeJobs = (2L << depth) - 1;
+	ms = measure([&] {
+		JobCounter counter;
+		executed = 0;
+		jobs.spawn([&] { spawnTree(jobs, counter, depth, executed); }, &counter);
+		jobs.wait(counter);
+	});
+	if (executed.load() != treeJobs)
+		cout << "ERROR::JOBS::TREE_COUNT " << executed.load() << " != " << treeJobs << endl;
+	printRow("tree", ms, treeJobs);
+
+	// chain: sequencial por construção; mede o custo de agendar continuações
+	int chainLength = std::min(numJobs, 10000);
+	ms = measure([&] {
+		vector<JobCounter> links(chainLength);
+		atomic<int> chainExecuted(0);
+		JobCounter finished;
+		Chain chain{&jobs, &links, &chainExecuted, &finished};
+		jobs.spawn([chain] { chain.link(0); }, &links[0]);
+		// O primeiro elo conta a continuação em "finished" antes de terminar
+		jobs.wait(links[0]);
+		jobs.wait(finished);
+		if (chainExecuted.load() != chainLength)
+			cout << "ERROR::JOBS::CHAIN_COUNT " << chainExecuted.load() << " != " << chainLength << endl;
+	});
+	printRow("chain", ms, chainLength);
+
+	// main: tarefas presas à thread principal, executadas no ponto de sincronização do quadro
+	ms = measure([&] {
+		for (int i = 0; i < numJobs; i++)
+			jobs.spawnMain([&executed] { executed.fetch_add(1, memory_order_relaxed); });
+		jobs.runMainThreadJobs();
+	});
+	printRow("main", ms, numJobs);
+
+	// for: trabalho real dividido em blocos
+	vector<float> data(4 * 1024 * 1024);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = (float)i;
+	double serial = measure([&] {
+		for (float &v : data)
+			v = sqrt(v * v + 1.0f);
+	});
+	size_t grain = 16 * 1024;
+	ms = measure([&] {
+		jobs.parallelFor(0, data.size(), grain, [&data](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++)
+				data[i] = sqrt(data[i] * data[i] + 1.0f);
+		});
+	});
+	printRow("for", ms, (long)((data.size() + grain - 1) / grain));
+	cout << "  " << left << setw(8) << "serial" << right << setw(10) << setprecision(3) << serial << " ms"
+		 << "   speedup " << setprecision(2) << serial / ms << "x\n";
+
+	// async: referência com uma thread (ou tarefa da biblioteca) por chamada
+	int asyncJobs = std::min(numJobs, 2000);
+	ms = measure([&] {
+		vector<future<void>> futures;
+		futures.reserve(asyncJobs);
+		for (int i = 0; i < asyncJobs; i++)
+			futures.push_back(async(launch::async, [&executed] { executed.fetch_add(1, memory_order_relaxed); }));
+		for (auto &f : futures)
+			f.get();
+	});
+	printRow("async", ms, asyncJobs);
+
+	jobs.shutdown();
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ * Benchmark da fila de desenho
+ *
+ * Descrição:
+ * Mede o sort() do RenderQueue (sem OpenGL) com pacotes do tamanho do ScenePacket da cena:
+ *   scene     - chaves como as da cena: pré-passada e opacos, 8 programas, 16 texturas
+ *               e 8 VAOs, profundidade aleatória
+ *   varied    - as três passadas (transparentes com os 20 bits de profundidade),
+ *               16 programas, 64 texturas e 32 VAOs
+ *   depth     - um único estado, só a profundidade muda (ex: pré-passada da frota)
+ *   random    - 64 bits aleatórios: nenhum bit pode ser pulado
+ *   sorted    - as chaves da cena já em ordem (quadro igual ao anterior)
+ *   std       - std::stable_sort das mesmas chaves da cena, como referência
+ *
+ * Cada teste enche a fila de novo e mede só a ordenação; é impresso o melhor tempo entre
+ * as repetições e o custo por pacote em nanossegundos. A saída é conferida (chaves em
+ * ordem, cada pacote uma vez); erros saem como ERROR::RENDERQUEUE::...
+ *
+ * Uso: RenderQueueBenchmark [--packets 50000] [--repeat 20]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+//GLM
+#include <glm/glm.hpp>
+
+#include "RenderQueue.h"
+
+static int numPackets = 50000;
+static int repeat = 20;
+
+// Mesmo tamanho do ScenePacket da cena
+struct Packet
+{
+	int pass;
+	const void *shader;
+	GLuint mesh, VAO, texID, material;
+	glm::mat4 model;
+	const void *quantized;
+	uint32_t id; // posição de chegada, para conferir a saída
+};
+
+void printRow(const string &name, double ms, long packets)
+{
+	cout << "  " << left << setw(8) << name << right << setw(10) << fixed << setprecision(3) << ms << " ms"
+		 << setw(10) << packets << " packets" << setw(10) << setprecision(1) << (ms * 1e6 / std::max(packets, 1L)) << " ns/packet\n";
+}
+
+// Melhor tempo (ms) de sort() entre as repetições; a fila é enchida fora da medida
+double measureSort(RenderQueue<Packet> &queue, const vector<uint64_t> &keys)
+{
+	double best = 1e30;
+	for (int r = 0; r < repeat; r++)
+	{
+		queue.clear();
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			Packet p = {};
+			p.id = (uint32_t)i;
+			queue.push(keys[i], p);
+		}
+		queue.sort();
+		best = std::min(best, queue.lastSortMicroseconds() / 1000.0);
+	}
+	return best;
+}
+
+// Chaves em ordem, estável (empates na ordem de chegada) e sem pacote perdido
+void verify(const RenderQueue<Packet> &queue, const vector<uint64_t> &keys, const string &name)
+{
+	vector<char> seen(keys.size(), 0);
+	for (size_t i = 0; i < queue.size(); i++)
+	{
+		const Packet &p = queue.packet(i);
+		if (queue.key(i) != keys[p.id] || seen[p.id]++)
+		{
+			cout << "ERROR::RENDERQUEUE::LOST_PACKET " << name << endl;
+			return;
+		}
+		if (i > 0 && (queue.key(i - 1) > queue.key(i) || (queue.key(i - 1) == queue.key(i) && queue.packet(i - 1).id > p.id)))
+		{
+			cout << "ERROR::RENDERQUEUE::NOT_SORTED " << name << " at " << i << endl;
+			return;
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		string arg = argv[i];
+		if (arg == "--packets")
+			numPackets = std::max(1, atoi(argv[i + 1]));
+		else if (arg == "--repeat")
+			repeat = std::max(1, atoi(argv[i + 1]));
+		else
+			cout << "Unknown option " << arg << endl;
+	}
+
+	cout << "Render queue: " << numPackets << " packets of " << sizeof(Packet) << " bytes, best of " << repeat << "\n\n";
+
+	RenderQueue<Packet> queue;
+	queue.reserve(numPackets);
+	mt19937_64 rng(1234);
+	uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+	vector<uint64_t> scene(numPackets);
+	for (uint64_t &key : scene)
+		key = sortkey::make((RenderPass)(rng() % 2), 1 + (GLuint)(rng() % 8), (GLuint)(rng() % 16), 1 + (GLuint)(rng() % 8), depth(rng));
+	double ms = measureSort(queue, scene);
+	verify(queue, scene, "scene");
+	printRow("scene", ms, numPackets);
+
+	vector<uint64_t> varied(numPackets);
+	for (uint64_t &key : varied)
+		key = sortkey::make((RenderPass)(rng() % 3), 1 + (GLuint)(rng() % 16), (GLuint)(rng() % 64), 1 + (GLuint)(rng() % 32), depth(rng));
+	ms = measureSort(queue, varied);
+	verify(queue, varied, "varied");
+	printRow("varied", ms, numPackets);
+
+	vector<uint64_t> depthOnly(numPackets);
+	for (uint64_t &key : depthOnly)
+		key = sortkey::make(PASS_DEPTH, 3, 0, 5, depth(rng));
+	ms = measureSort(queue, depthOnly);
+	verify(queue, depthOnly, "depth");
+	printRow("depth", ms, numPackets);
+
+	vector<uint64_t> random(numPackets);
+	for (uint64_t &key : random)
+		key = rng();
+	ms = measureSort(queue, random);
+	verify(queue, random, "random");
+	printRow("random", ms, numPackets);
+
+	vector<uint64_t> sorted = scene;
+	std::sort(sorted.begin(), sorted.end());
+	ms = measureSort(queue, sorted);
+	verify(queue, sorted, "sorted");
+	printRow("sorted", ms, numPackets);
+
+	// Referência: ordenação por comparação das mesmas chaves com o índice do pacote
+	double best = 1e30;
+	vector<pair<uint64_t, uint32_t>> entries(numPackets);
+	for (int r = 0; r < repeat; r++)
+	{
+		for (int i = 0; i < numPackets; i++)
+			entries[i] = {scene[i], (uint32_t)i};
+		auto start = chrono::steady_clock::now();
+		std::stable_sort(entries.begin(), entries.end(), [](const pair<uint64_t, uint32_t> &a, const pair<uint64_t, uint32_t> &b) {
+			return a.first < b.first;
+		});
+		best = std::min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	printRow("std", best, numPackets);
+	return 0;
+}
@@ -0,0 +1,582 @@
+/*
+ * Benchmark do caminho de texturas
+ *
+ * Descrição:
+ * Passa todas as imagens encontradas em Modelos3D pelas etapas do carregamento de
+ * texturas, num contexto OpenGL sem janela visível:
+ *   decode   - decodificação para RGBA8 (ImageDecoder, com cada backend disponível)
+ *   mipmaps  - geração da cadeia de mipmaps na CPU
+ *   compress - compressão pelo driver (glTexImage2D com formato comprimido + glGetCompressedTexImage)
+ *   upload   - envio de todos os níveis pelo UploadRing para uma textura imutável
+ *
+ * Para cada etapa são medidos o tempo (melhor de N repetições), a vazão em megapixels
+ * do nível 0 por segundo, os bytes residentes na GPU e o pico de memória transitória na CPU.
+ * O resultado vai para um arquivo JSON e um resumo em tabela é impresso no terminal.
+ *
+ * A memória transitória conta as alocações feitas com new (vetores) durante a etapa.
+ * O stb_image aloca a imagem com malloc, então esse buffer é somado à parte no decode.
+ *
+ * Uso: TextureBenchmark [--root ../Modelos3D] [--out texture_benchmark.json] [--repeat 3]
+ *                       [--decoders stb,turbo] [--formats rgba8,dxt1,dxt5,bptc]
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <filesystem>
+#include <algorithm>
+
+using namespace std;
+
+//GLAD
+#include <glad/glad.h>
+
+// GLFW
+#include <GLFW/glfw3.h>
+
+#include "GLExtensoes.h"
+#include "GpuMemory.h"
+#include "ImageDecoder.h"
+#include "UploadRing.h"
+#include "TextureStreamer.h"
+
+// Contagem das alocações com new, para medir o pico de memória transitória
+static std::atomic<size_t> allocatedBytes(0);
+static std::atomic<size_t> peakAllocatedBytes(0);
+
+void *operator new(size_t size)
+{
+	// Guarda o tamanho antes do bloco para descontar no delete
+	void *block = std::malloc(size + 16);
+	if (!block)
+		throw std::bad_alloc();
+	*(size_t *)block = size;
+	size_t current = allocatedBytes.fetch_add(size) + size;
+	size_t peak = peakAllocatedBytes.load();
+	while (current > peak && !peakAllocatedBytes.compare_exchange_weak(peak, current))
+		;
+	return (char *)block + 16;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	if (!ptr)
+		return;
+	void *block = (char *)ptr - 16;
+	allocatedBytes.fetch_sub(*(size_t *)block);
+	std::free(block);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+// Resultado de uma etapa
+struct StageResult
+{
+	bool supported = true;
+	double ms = 0.0;
+	double megapixelsPerSecond = 0.0;
+	size_t residentBytes = 0;
+	size_t peakTransientBytes = 0;
+};
+
+// Mede uma etapa: melhor tempo entre as repetições e pico de memória transitória.
+// "prepare" roda antes de cada repetição, fora da medição (ex: liberar o resultado anterior).
+template <typename Prepare, typename Fn>
+StageResult measureStage(int repeat, size_t basePixels, Prepare prepare, Fn stage)
+{
+	StageResult result;
+	result.ms = 1e30;
+	for (int i = 0; i < repeat; i++)
+	{
+		prepare();
+		size_t before = allocatedBytes.load();
+		peakAllocatedBytes.store(before);
+
+		auto start = chrono::steady_clock::now();
+		stage();
+		auto end = chrono::steady_clock::now();
+
+		result.ms = std::min(result.ms, chrono::duration<double, milli>(end - start).count());
+		result.peakTransientBytes = std::max(result.peakTransientBytes, peakAllocatedBytes.load() - before);
+	}
+	result.megapixelsPerSecond = result.ms > 0.0 ? (basePixels / 1e6) / (result.ms / 1000.0) : 0.0;
+	return result;
+}
+
+// Formato de armazenamento na GPU
+struct TextureFormat
+{
+	string name;
+	GLenum internalFormat;
+	bool compressed;
+	bool supported;
+};
+
+// Um nível de mipmap já no formato final (RGBA8 ou blocos comprimidos)
+struct EncodedLevel
+{
+	int width, height;
+	vector<unsigned char> bytes;
+};
+
+struct FormatResult
+{
+	string format;
+	StageResult compress;
+	StageResult upload;
+};
+
+struct ImageResult
+{
+	string path;
+	int width = 0, height = 0;
+	size_t fileBytes = 0;
+	vector<pair<string, StageResult>> decode;
+	StageResult mipmaps;
+	vector<FormatResult> formats;
+};
+
+// Configuração lida da linha de comando
+string rootDir = "../Modelos3D";
+string outputPath = "texture_benchmark.json";
+int repeat = 3;
+vector<string> decoders = {"stb", "turbo"};
+vector<string> formatNames = {"rgba8", "dxt1", "dxt5", "bptc"};
+
+GpuMemoryRegistry gpuMemory;
+
+vector<string> splitList(const string &list)
+{
+	vector<string> items;
+	stringstream ss(list);
+	string item;
+	while (getline(ss, item, ','))
+		if (!item.empty())
+			items.push_back(item);
+	return items;
+}
+
+bool isImageFile(const filesystem::path &path)
+{
+	string ext = path.extension().string();
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".png" || ext == ".jpg" || ext == ".jpeg" || ext == ".tga" || ext == ".bmp";
+}
+
+bool isJPEGFile(const filesystem::path &path)
+{
+	string ext = path.extension().string();
+	transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+	return ext == ".jpg" || ext == ".jpeg";
+}
+
+vector<TextureFormat> availableFormats()
+{
+	bool s3tc = glx::hasExtension("GL_EXT_texture_compression_s3tc");
+	bool bptc = glx::versionAtLeast(4, 2) || glx::hasExtension("GL_ARB_texture_compression_bptc");
+
+	vector<TextureFormat> all = {
+		{"rgba8", GL_RGBA8, false, true},
+		{"dxt1", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, true, s3tc},
+		{"dxt5", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, true, s3tc},
+		{"bptc", GL_COMPRESSED_RGBA_BPTC_UNORM, true, bptc},
+	};
+	vector<TextureFormat> selected;
+	for (const TextureFormat &f : all)
+		if (find(formatNames.begin(), formatNames.end(), f.name) != formatNames.end())
+			selected.push_back(f);
+	return selected;
+}
+
+// Comprime a cadeia pelo driver e lê os blocos de volta
+bool compressChain(const vector<MipLevel> &chain, const TextureFormat &format, vector<EncodedLevel> &encoded)
+{
+	encoded.clear();
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	bool ok = true;
+	for (size_t level = 0; level < chain.size() && ok; level++)
+	{
+		const MipLevel &mip = chain[level];
+		glTexImage2D(GL_TEXTURE_2D, (GLint)level, format.internalFormat, mip.width, mip.height, 0,
+					 GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+
+		GLint isCompressed = 0, size = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, (GLint)level, GL_TEXTURE_COMPRESSED, &isCompressed);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, (GLint)level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size);
+		if (!isCompressed || size <= 0)
+		{
+			ok = false;
+			break;
+		}
+		EncodedLevel out;
+		out.width = mip.width;
+		out.height = mip.height;
+		out.bytes.resize(size);
+		glGetCompressedTexImage(GL_TEXTURE_2D, (GLint)level, out.bytes.data());
+		encoded.push_back(std::move(out));
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDeleteTextures(1, &tex);
+	return ok;
+}
+
+// Envia todos os níveis para uma textura nova e espera a GPU terminar.
+// Retorna a textura (registrada no gpuMemory) e os bytes residentes.
+GLuint uploadChain(UploadRing &ring, const vector<EncodedLevel> &levels, const TextureFormat &format, size_t &residentBytes)
+{
+	size_t total = 0;
+	for (const EncodedLevel &level : levels)
+		total += level.bytes.size();
+
+	GLuint tex;
+	glGenTextures(1, &tex);
+	glBindTexture(GL_TEXTURE_2D, tex);
+	if (glx::TexStorage2D)
+	{
+		glx::TexStorage2D(GL_TEXTURE_2D, (GLsizei)levels.size(), format.internalFormat, levels[0].width, levels[0].height);
+	}
+	else
+	{
+		for (size_t l = 0; l < levels.size(); l++)
+		{
+			if (format.compressed)
+				glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)l, format.internalFormat, levels[l].width, levels[l].height, 0,
+									   (GLsizei)levels[l].bytes.size(), NULL);
+			else
+				glTexImage2D(GL_TEXTURE_2D, (GLint)l, format.internalFormat, levels[l].width, levels[l].height, 0,
+							 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+
+	// Mesmo caminho da aplicação: cópia para o anel mapeado e envio a partir do PBO
+	UploadSlice slice;
+	ring.retire();
+	bool inRing = ring.tryAllocate(total, slice);
+	if (inRing)
+		ring.bind();
+	size_t offset = 0;
+	for (size_t l = 0; l < levels.size(); l++)
+	{
+		const EncodedLevel &level = levels[l];
+		const void *src = level.bytes.data();
+		if (inRing)
+		{
+			memcpy(slice.ptr + offset, level.bytes.data(), level.bytes.size());
+			src = ring.source(slice, offset);
+		}
+		if (format.compressed)
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)l, 0, 0, level.width, level.height, format.internalFormat,
+									  (GLsizei)level.bytes.size(), src);
+		else
+			glTexSubImage2D(GL_TEXTURE_2D, (GLint)l, 0, 0, level.width, level.height, GL_RGBA, GL_UNSIGNED_BYTE, src);
+		offset += level.bytes.size();
+	}
+	if (inRing)
+	{
+		ring.unbind();
+		ring.submit(slice);
+	}
+	glFinish();
+	ring.retire();
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	residentBytes = total;
+	gpuMemory.trackTexture(tex, total, GpuSubsystem::Textures, format.name);
+	return tex;
+}
+
+ImageResult benchmarkImage(const filesystem::path &path, UploadRing &ring, const vector<TextureFormat> &formats)
+{
+	ImageResult result;
+	result.path = path.generic_string();
+	result.fileBytes = (size_t)filesystem::file_size(path);
+
+	int width = 0, height = 0;
+	if (!imageInfo(result.path, width, height))
+	{
+		cout << "Failed to load texture " << result.path << endl;
+		return result;
+	}
+	result.width = width;
+	result.height = height;
+	size_t basePixels = (size_t)width * height;
+
+	// Decodificação com cada backend pedido
+	vector<unsigned char> pixels;
+	for (const string &name : decoders)
+	{
+		ImageDecoderBackend backend = name == "turbo" ? ImageDecoderBackend::LibJpegTurbo : ImageDecoderBackend::StbImage;
+#ifndef USE_LIBJPEG_TURBO
+		if (backend == ImageDecoderBackend::LibJpegTurbo)
+		{
+			StageResult unsupported;
+			unsupported.supported = false;
+			result.decode.push_back({name, unsupported});
+			continue;
+		}
+#endif
+		imageDecoderBackend = backend;
+		StageResult stage = measureStage(repeat, basePixels, [&]() { vector<unsigned char>().swap(pixels); }, [&]() {
+			int w, h;
+			decodeImageRGBA(result.path, w, h, pixels);
+		});
+		if (backend == ImageDecoderBackend::StbImage || !isJPEGFile(path))
+			stage.peakTransientBytes += basePixels * 4; // imagem alocada pelo stb_image com malloc
+		result.decode.push_back({name, stage});
+	}
+	if (pixels.empty())
+		return result;
+
+	// Cadeia de mipmaps
+	vector<MipLevel> chain;
+	result.mipmaps = measureStage(repeat, basePixels, [&]() { vector<MipLevel>().swap(chain); }, [&]() {
+		chain = generateMipChain(pixels.data(), width, height);
+	});
+	vector<unsigned char>().swap(pixels);
+
+	// Compressão e envio em cada formato
+	for (const TextureFormat &format : formats)
+	{
+		FormatResult fr;
+		fr.format = format.name;
+		if (!format.supported)
+		{
+			fr.compress.supported = fr.upload.supported = false;
+			result.formats.push_back(fr);
+			continue;
+		}
+
+		vector<EncodedLevel> encoded;
+		bool ok = true;
+		if (format.compressed)
+		{
+			fr.compress = measureStage(repeat, basePixels, [&]() { vector<EncodedLevel>().swap(encoded); }, [&]() {
+				ok = compressChain(chain, format, encoded);
+			});
+		}
+		else
+		{
+			// Sem compressão: os níveis seguem como estão
+			fr.compress.supported = false;
+			for (const MipLevel &mip : chain)
+				encoded.push_back({mip.width, mip.height, mip.pixels});
+		}
+		if (!ok)
+		{
+			fr.compress.supported = fr.upload.supported = false;
+			result.formats.push_back(fr);
+			continue;
+		}
+		size_t resident = 0;
+		fr.upload = measureStage(repeat, basePixels, []() {}, [&]() {
+			GLuint tex = uploadChain(ring, encoded, format, resident);
+			gpuMemory.release(GpuResourceType::Texture, tex);
+		});
+		fr.upload.residentBytes = resident;
+		result.formats.push_back(fr);
+	}
+	return result;
+}
+
+string jsonString(const string &s)
+{
+	string out = "\"";
+	for (char c : s)
+	{
+		if (c == '"' || c == '\\')
+			out += '\\';
+		out += c;
+	}
+	return out + "\"";
+}
+
+void writeStage(ostream &out, const StageResult &stage)
+{
+	out << "{\"supported\": " << (stage.supported ? "true" : "false");
+	if (stage.supported)
+		out << ", \"ms\": " << stage.ms << ", \"megapixelsPerSecond\": " << stage.megapixelsPerSecond
+			<< ", \"residentBytes\": " << stage.residentBytes << ", \"peakTransientBytes\": " << stage.peakTransientBytes;
+	out << "}";
+}
+
+void writeJSON(const string &path, const vector<ImageResult> &results)
+{
+	ofstream out(path);
+	out << fixed << setprecision(3);
+	out << "{\n";
+	out << "  \"renderer\": " << jsonString((const char *)glGetString(GL_RENDERER)) << ",\n";
+	out << "  \"version\": " << jsonString((const char *)glGetString(GL_VERSION)) << ",\n";
+	out << "  \"repeat\": " << repeat << ",\n";
+	out << "  \"persistentUploadRing\": " << (glx::BufferStorage ? "true" : "false") << ",\n";
+	out << "  \"gpuPeakBytes\": " << gpuMemory.getStats().peakBytes << ",\n";
+	out << "  \"images\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const ImageResult &r = results[i];
+		out << "    {\n";
+		out << "      \"path\": " << jsonString(r.path) << ",\n";
+		out << "      \"width\": " << r.width << ", \"height\": " << r.height << ", \"fileBytes\": " << r.fileBytes << ",\n";
+		out << "      \"decode\": {";
+		for (size_t d = 0; d < r.decode.size(); d++)
+		{
+			out << (d ? ", " : "") << jsonString(r.decode[d].first) << ": ";
+			writeStage(out, r.decode[d].second);
+		}
+		out << "},\n";
+		out << "      \"mipmaps\": ";
+		writeStage(out, r.mipmaps);
+		out << ",\n";
+		out << "      \"formats\": {\n";
+		for (size_t f = 0; f < r.formats.size(); f++)
+		{
+			out << "        " << jsonString(r.formats[f].format) << ": {\"compress\": ";
+			writeStage(out, r.formats[f].compress);
+			out << ", \"upload\": ";
+			writeStage(out, r.formats[f].upload);
+			out << "}" << (f + 1 < r.formats.size() ? "," : "") << "\n";
+		}
+		out << "      }\n";
+		out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+void printRow(const string &image, const string &setting, const string &stage, const StageResult &r)
+{
+	cout << left << setw(34) << image.substr(0, 33) << setw(8) << setting << setw(10) << stage << right;
+	if (!r.supported)
+	{
+		cout << setw(10) << "-" << "\n";
+		return;
+	}
+	cout << setw(10) << r.ms << setw(10) << r.megapixelsPerSecond << setw(12) << r.residentBytes / (1024.0 * 1024.0)
+		 << setw(12) << r.peakTransientBytes / (1024.0 * 1024.0) << "\n";
+}
+
+void printSummary(const vector<ImageResult> &results)
+{
+	cout << fixed << setprecision(2);
+	cout << left << setw(34) << "image" << setw(8) << "setting" << setw(10) << "stage" << right << setw(10) << "ms"
+		 << setw(10) << "MPix/s" << setw(12) << "resident MB" << setw(12) << "peak CPU MB" << "\n";
+
+	// Totais por configuração
+	vector<pair<string, double>> totals;
+	auto addTotal = [&](const string &key, const StageResult &r) {
+		if (!r.supported)
+			return;
+		for (auto &t : totals)
+			if (t.first == key)
+			{
+				t.second += r.ms;
+				return;
+			}
+		totals.push_back({key, r.ms});
+	};
+
+	for (const ImageResult &r : results)
+	{
+		string name = filesystem::path(r.path).filename().string();
+		for (const auto &d : r.decode)
+		{
+			printRow(name, d.first, "decode", d.second);
+			addTotal("decode " + d.first, d.second);
+		}
+		printRow(name, "", "mipmaps", r.mipmaps);
+		addTotal("mipmaps", r.mipmaps);
+		for (const FormatResult &f : r.formats)
+		{
+			printRow(name, f.format, "compress", f.compress);
+			printRow(name, f.format, "upload", f.upload);
+			addTotal("compress " + f.format, f.compress);
+			addTotal("upload " + f.format, f.upload);
+		}
+	}
+
+	cout << "\nTotal time per setting (" << results.size() << " images):\n";
+	for (const auto &t : totals)
+		cout << "  " << left << setw(20) << t.first << right << setw(10) << t.second << " ms\n";
+}
+
+int main(int argc, char **argv)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		string arg = argv[i];
+		if (arg == "--root")
+			rootDir = argv[i + 1];
+		else if (arg == "--out")
+			outputPath = argv[i + 1];
+		else if (arg == "--repeat")
+			repeat = std::max(1, atoi(argv[i + 1]));
+		else if (arg == "--decoders")
+			decoders = splitList(argv[i + 1]);
+		else if (arg == "--formats")
+			formatNames = splitList(argv[i + 1]);
+		else
+			cout << "Unknown option " << arg << endl;
+	}
+
+	// Contexto sem janela visível
+	glfwInit();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow *window = glfwCreateWindow(64, 64, "Texture Benchmark", nullptr, nullptr);
+	if (!window)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+	glx::loadExtensions();
+
+	vector<filesystem::path> images;
+	for (const auto &entry : filesystem::recursive_directory_iterator(rootDir))
+		if (entry.is_regular_file() && isImageFile(entry.path()))
+			images.push_back(entry.path());
+	sort(images.begin(), images.end());
+	cout << "Benchmarking " << images.size() << " images under " << rootDir << " on " << glGetString(GL_RENDERER) << endl;
+
+	UploadRing ring;
+	ring.create(64u * 1024u * 1024u);
+	if (ring.isPersistent())
+		gpuMemory.trackBuffer(ring.buffer(), GL_PIXEL_UNPACK_BUFFER, ring.size(), GpuSubsystem::Upload, "benchmark upload ring");
+
+	vector<TextureFormat> formats = availableFormats();
+	vector<ImageResult> results;
+	for (const filesystem::path &path : images)
+	{
+		cout << "  " << path.generic_string() << endl;
+		results.push_back(benchmarkImage(path, ring, formats));
+	}
+
+	writeJSON(outputPath, results);
+	cout << endl;
+	printSummary(results);
+	cout << "\n" << gpuMemory.report();
+	cout << "Results written to " << outputPath << endl;
+
+	if (ring.isPersistent())
+		gpuMemory.untrack(GpuResourceType::Buffer, ring.buffer());
+	ring.destroy();
+	glfwTerminate();
+	return 0;
+}
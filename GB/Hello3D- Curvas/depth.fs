@@ -0,0 +1,6 @@
+#version 430
+
+//Só profundidade: a cor está desligada na pré-passada
+void main()
+{
+}
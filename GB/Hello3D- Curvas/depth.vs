@@ -0,0 +1,30 @@
+#version 430
+// Pré-passada de profundidade (DepthPrepass.h). Variação por #define: INSTANCING
+//Só a posição: o fluxo da pré-passada é o formato PositionVertex (VertexLayout.h)
+VERTEX_INPUTS
+
+#ifdef INSTANCING
+//Matriz de modelo por instância, do mesmo buffer do InstanceBatch (localizações 6 a 9)
+layout (location = 6) in mat4 instanceModel;
+#else
+uniform mat4 model;
+#endif
+
+//Dados da câmera, compartilhados por todos os shaders (UniformBlocks.h)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+//A mesma conta do phong.vs: as duas passadas precisam chegar à mesma profundidade
+invariant gl_Position;
+
+void main()
+{
+#ifdef INSTANCING
+	mat4 model = instanceModel;
+#endif
+	gl_Position = projection * view * model * vec4(position, 1.0);
+}
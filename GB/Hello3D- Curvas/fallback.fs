@@ -0,0 +1,13 @@
+#version 430
+
+in vec2 texCoord;
+
+out vec4 color;
+//Buffer da textura
+layout (binding = 0) uniform sampler2D texBuffer;
+
+//Só a textura, sem iluminação
+void main()
+{
+    color = vec4(texture(texBuffer, texCoord).rgb, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 430
+//Atributos do vértice, gerados a partir do formato ObjVertex (VertexLayout.h)
+VERTEX_INPUTS
+
+uniform mat4 model;
+
+//Dados da câmera, compartilhados por todos os shaders (UniformBlocks.h)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+out vec2 texCoord;
+
+//Mesma profundidade da pré-passada (depth.vs)
+invariant gl_Position;
+
+//Programa substituto: usado enquanto o phong ainda está compilando
+void main()
+{
+	gl_Position = projection * view * model * vec4(position, 1.0);
+    texCoord = vec2(texc.s, 1 - texc.t);
+}
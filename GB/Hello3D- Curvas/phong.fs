@@ -1,25 +1,54 @@
 #version 430
+// Variações por #define (ShaderPermutations.h): TEXTURED, SHADOWS
 
 in vec3 finalColor;
 in vec2 texCoord;
 in vec3 scaledNormal;
 in vec3 fragPos;
+flat in uint materialID;
 
-//Propriedades da superficie
-uniform float ka, kd, ks, q;
+//Propriedades da câmera
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
 
 //Propriedades da fonte de luz
-uniform vec3 lightPos, lightColor;
+layout (std140, binding = 1) uniform LightData
+{
+    vec3 lightPos;
+    vec3 lightColor;
+    mat4 lightSpace;
+};
 
-//Propriedades da câmera
-uniform vec3 cameraPos;
+//Propriedades da superficie: todos os materiais da cena (MaterialRegistry.h)
+struct Material
+{
+    float ka, kd, ks, q;
+};
+layout (std430, binding = 0) readonly buffer MaterialData
+{
+    Material materials[];
+};
 
 out vec4 color;
+#ifdef TEXTURED
 //Buffer da textura
-uniform sampler2D texBuffer;
+layout (binding = 0) uniform sampler2D texBuffer;
+#endif
+
+#ifdef SHADOWS
+//Mapa de profundidade visto da luz
+layout (binding = 1) uniform sampler2DShadow shadowMap;
+in vec4 lightSpacePos;
+#endif
 
 void main()
 {
+    Material material = materials[materialID];
+    float ka = material.ka, kd = material.kd, ks = material.ks, q = material.q;
 
     //Coeficiente luz ambiente
     vec3 ambient = ka * lightColor;
@@ -40,8 +69,20 @@ void main()
     spec = pow(spec,q);
     specular = ks * spec * lightColor;
 
-    vec4 texColor = texture(texBuffer,texCoord);
-    vec3 result = (ambient + diffuse) * vec3(texColor) + specular;
+#ifdef SHADOWS
+    //Fora da sombra: 1, dentro: 0 (com comparação e filtragem do hardware)
+    vec3 shadowCoord = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+    float lit = texture(shadowMap, vec3(shadowCoord.xy, shadowCoord.z - 0.002));
+    diffuse *= lit;
+    specular *= lit;
+#endif
+
+#ifdef TEXTURED
+    vec3 baseColor = vec3(texture(texBuffer,texCoord));
+#else
+    vec3 baseColor = finalColor;
+#endif
+    vec3 result = (ambient + diffuse) * baseColor + specular;
 
     color = vec4(result,1.0);
 }
\ No newline at end of file
@@ -1,25 +1,71 @@
 #version 430
-layout (location = 0) in vec3 position;
-layout (location = 1) in vec3 color;
-layout (location = 2) in vec2 texc;
-layout (location = 3) in vec3 normal;
+// Variações por #define (ShaderPermutations.h): QUANTIZED_VERTICES, INSTANCING, SHADOWS
+//Atributos do vértice (position, color, texc, normal), gerados a partir do formato
+//ObjVertex (VertexLayout.h) e passados pelo programa como define
+VERTEX_INPUTS
 
+//Índice do material, um por instância: a instância base do desenho (MaterialRegistry.h)
+layout (location = 4) in uint materialIndex;
+
+#ifdef INSTANCING
+//Matriz de modelo por instância (ocupa as localizações 6 a 9)
+layout (location = 6) in mat4 instanceModel;
+#else
 uniform mat4 model;
-uniform mat4 projection;
-uniform mat4 view;
+#endif
+
+#ifdef QUANTIZED_VERTICES
+//Posição em inteiros normalizados: volta para o espaço do objeto
+uniform vec3 quantScale;
+uniform vec3 quantOffset;
+#endif
+
+//Dados da câmera, compartilhados por todos os shaders (UniformBlocks.h)
+layout (std140, binding = 0) uniform FrameData
+{
+    mat4 view;
+    mat4 projection;
+    vec3 cameraPos;
+};
+
+#ifdef SHADOWS
+layout (std140, binding = 1) uniform LightData
+{
+    vec3 lightPos;
+    vec3 lightColor;
+    mat4 lightSpace;
+};
+out vec4 lightSpacePos;
+#endif
 
 //Variáveis que irão para o fragment shader
 out vec3 finalColor;
 out vec2 texCoord;
 out vec3 scaledNormal;
 out vec3 fragPos;
+flat out uint materialID;
+
+//Mesma profundidade da pré-passada (depth.vs)
+invariant gl_Position;
 
 void main()
 {
+#ifdef INSTANCING
+	mat4 model = instanceModel;
+#endif
+#ifdef QUANTIZED_VERTICES
+	vec3 objectPos = position * quantScale + quantOffset;
+#else
+	vec3 objectPos = position;
+#endif
 	//...pode ter mais linhas de código aqui!
-	gl_Position = projection * view * model * vec4(position, 1.0);
+	gl_Position = projection * view * model * vec4(objectPos, 1.0);
 	finalColor = color;
     texCoord = vec2(texc.s, 1 - texc.t);
-    fragPos = vec3(model * vec4(position, 1.0));
+    fragPos = vec3(model * vec4(objectPos, 1.0));
     scaledNormal = vec3(model * vec4(normal, 1.0));
-}
\ No newline at end of file
+    materialID = materialIndex;
+#ifdef SHADOWS
+    lightSpacePos = lightSpace * vec4(fragPos, 1.0);
+#endif
+}